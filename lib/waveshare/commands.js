@@ -4,17 +4,37 @@
 const COMMANDS = {
   FB_MOTOR: { T: 20010, desc: 'Feedback: motor data (FB_MOTOR)' },
   FB_INFO: { T: 20011, desc: 'Feedback: info data (FB_INFO)' },
+  FB_HEALTH: { T: 20012, desc: 'Feedback: link counters of one motor (FB_HEALTH)' },
+  FB_DISCOVER: { T: 20013, desc: 'Feedback: a motor found by the bus scan (FB_DISCOVER)' },
+  FB_ODOM: { T: 20014, desc: 'Feedback: rover pose from the wheel odometry (FB_ODOM)' },
+  FB_STATE: { T: 20015, desc: 'Feedback: estimated motor state (FB_STATE)' },
+  FB_HEARTBEAT: { T: 20016, desc: 'Feedback: the heartbeat stopped the motors (FB_HEARTBEAT)' },
+  FB_BATCH: { T: 20017, desc: 'Feedback: result of a batch of commands (FB_BATCH)' },
+  FB_DRIVE: { T: 20018, desc: 'Feedback: wheel frames sent for a drive command (FB_DRIVE)' },
 
   CMD_DDSM_STOP: { T: 10000, desc: 'Stop motor', example: (id) => ({ T: 10000, id }) },
   CMD_DDSM_CTRL: { T: 10010, desc: 'Control motor (current/speed/position)', example: (id, cmd, act) => ({ T: 10010, id, cmd, act }) },
+  CMD_DDSM_CTRL_BURST: { T: 10013, desc: 'Control several motors, one frame after the other\'s reply', example: (id, cmd, act) => ({ T: 10013, id, cmd, act }) },
+  CMD_DDSM_DRIVE: { T: 10014, desc: 'Drive the rover: v mm/s, w mrad/s to every odometry wheel, limited per model, queued back to back', example: (v, w, act) => ({ T: 10014, v, w, act }) },
+  CMD_DDSM_BATCH: { T: 10100, desc: 'Several ctrl/stop/info commands checked together and queued back to back, one FB_BATCH once all are answered', example: (cmds) => ({ T: 10100, cmds }) },
   CMD_DDSM_CHANGE_ID: { T: 10011, desc: 'Change motor ID', example: (id) => ({ T: 10011, id }) },
   CMD_CHANGE_MODE: { T: 10012, desc: 'Change motor mode', example: (id, mode) => ({ T: 10012, id, mode }) },
 
   CMD_DDSM_ID_CHECK: { T: 10031, desc: 'Query motor ID (only one motor connected)', example: () => ({ T: 10031 }) },
   CMD_DDSM_INFO: { T: 10032, desc: 'Request motor info', example: (id) => ({ T: 10032, id }) },
+  CMD_DDSM_INFO_ALL: { T: 10036, desc: 'Request the info of several motors, one reply apart (no ids: all found)', example: (ids) => (ids ? { T: 10036, id: ids } : { T: 10036 }) },
+  CMD_DDSM_DISCOVER: { T: 10034, desc: 'Scan ids first..last for motors and their model', example: (first, last) => ({ T: 10034, first, last }) },
+  CMD_DDSM_HEALTH: { T: 10033, desc: 'Dump per-motor link counters (clear=1 resets them)', example: (clear) => (clear ? { T: 10033, clear: 1 } : { T: 10033 }) },
+  CMD_DDSM_STATE: { T: 10037, desc: 'Estimated speed/position of a motor dt ms ahead, no bus traffic (no id: all)', example: (id, dt) => (dt ? { T: 10037, id, dt } : { T: 10037, id }) },
+  CMD_DDSM_ODOM: { T: 10035, desc: 'Query the odometry pose (reset=1 zeroes it after the reply)', example: (reset) => (reset ? { T: 10035, reset: 1 } : { T: 10035 }) },
 
   CMD_HEARTBEAT_TIME: { T: 11001, desc: 'Set heartbeat timeout (ms). -1 disables auto-stop', example: (timeMs) => ({ T: 11001, time: timeMs }) },
   CMD_TYPE: { T: 11002, desc: 'Set DDSM type (115 or 210)', example: (type) => ({ T: 11002, type }) },
+  CMD_DDSM_RETRY: { T: 11003, desc: 'Retries of a lost ctrl/info reply (0 = off)', example: (retry) => ({ T: 11003, retry }) },
+  CMD_DDSM_TIMEOUT: { T: 11004, desc: 'Limits (us) of the adaptive reply timeout', example: (floor, ceil) => ({ T: 11004, floor, ceil }) },
+  CMD_DDSM_MODEL: { T: 11005, desc: 'Model (115 or 210, 0 = CMD_TYPE one) of one motor id', example: (id, type) => ({ T: 11005, id, type }) },
+  CMD_DDSM_ODOM_CFG: { T: 11006, desc: 'Odometry wheels and geometry (m)', example: (r, track, left, right, flip) => ({ T: 11006, r, track, left, right, flip }) },
+  CMD_DDSM_FB_MODE: { T: 11007, desc: 'Motor replies as 16-byte binary records (1) or JSON lines (0)', example: (bin) => ({ T: 11007, bin }) },
 
   CMD_WIFI_ON_BOOT: { T: 10401, desc: 'Set wifi-on-boot mode', example: (cmd) => ({ T: 10401, cmd }) },
   CMD_SET_AP: { T: 10402, desc: 'Configure AP mode', example: (ssid, password) => ({ T: 10402, ssid, password }) },
@@ -0,0 +1,69 @@
+#include "ddsm_bincmd.h"
+
+DDSM_BINCMD_PARSER::DDSM_BINCMD_PARSER()
+    : frames(0),
+      errors(0),
+      stale(0),
+      len(0),
+      last_us(0)
+{
+  buf[1] = 0;
+  buf[2] = 0xFF;
+}
+
+// drop a frame in progress, the counters are kept.
+void DDSM_BINCMD_PARSER::reset() {
+  len = 0;
+}
+
+int DDSM_BINCMD_PARSER::feed(uint8_t b, uint32_t now_us) {
+  if (len > 0 && now_us - last_us > DDSM_BINCMD_IDLE_US) {
+    // b starts over, binary or text.
+    len = 0;
+    stale++;
+  }
+  last_us = now_us;
+  if (len == 0) {
+    if (b != DDSM_BINCMD_SYNC) {
+      return DDSM_BINCMD_TEXT;
+    }
+    buf[len++] = b;
+    return DDSM_BINCMD_NONE;
+  }
+  if (len == 1 && b > DDSM_BINCMD_ARGS_MAX) {
+    // can't be a frame.
+    len = 0;
+    errors++;
+    return DDSM_BINCMD_NONE;
+  }
+  buf[len++] = b;
+  if (len < 4 || len < (size_t)buf[1] + 4) {
+    return DDSM_BINCMD_NONE;
+  }
+  len = 0;
+  if (crc8_frame(buf, buf[1] + 3) != b) {
+    errors++;
+    return DDSM_BINCMD_NONE;
+  }
+  frames++;
+  return DDSM_BINCMD_FRAME;
+}
+
+int DDSM_BINCMD_PARSER::cmds(ddsm_cmd *out, int max) const {
+  const uint8_t *a = buf + 3;
+  int n = 0;
+  if (buf[2] == DDSM_BINCMD_CTRL && buf[1] % 4 == 0) {
+    for (; n < buf[1] / 4 && n < max; n++, a += 4) {
+      out[n].id = a[0];
+      out[n].cmd = (int16_t)ddsm_be16(a + 1);
+      out[n].act = a[3];
+    }
+  } else if (buf[2] == DDSM_BINCMD_STOP) {
+    for (; n < buf[1] && n < max; n++) {
+      out[n].id = a[n];
+      out[n].cmd = 0;
+      out[n].act = 0;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,106 @@
+#ifndef _DDSM_BINCMD_H
+#define _DDSM_BINCMD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_driver.h"
+
+// binary setpoint commands to the bridge, on the same link as the JSON
+// commands, for high rate streams that shouldn't go through a JSON parse.
+// 0    1   2  3..           3+LEN
+// SYNC LEN OP ARGS[LEN]     CRC8
+// SYNC: 0xA5, as the telemetry records (ddsm_record.h).
+// CRC8: CRC-8/MAXIM of bytes 0..2+LEN.
+// ops, named after the JSON command they replace:
+// DDSM_BINCMD_STOP (10000): ID per motor
+// DDSM_BINCMD_CTRL (10010): ID CMD_H CMD_L ACT per motor, cmd signed,
+//                           one motor or a burst of up to 8.
+// JSON commands are plain ASCII, so SYNC can't start one.
+
+#define DDSM_BINCMD_SYNC 0xA5
+#define DDSM_BINCMD_STOP 0x00
+#define DDSM_BINCMD_CTRL 0x10
+
+// motors in one command.
+#define DDSM_BINCMD_MAX 8
+#define DDSM_BINCMD_ARGS_MAX (DDSM_BINCMD_MAX * 4)
+// longest frame.
+#define DDSM_BINCMD_LENGTH (DDSM_BINCMD_ARGS_MAX + 4)
+
+// a frame in progress that gets no byte for this long is dropped (us):
+// a sender writes a frame at once, a stray SYNC mustn't take the next
+// JSON line with it.
+#define DDSM_BINCMD_IDLE_US 20000
+
+// what DDSM_BINCMD_PARSER::feed() did with a byte.
+#define DDSM_BINCMD_NONE 0   // part of a frame
+#define DDSM_BINCMD_TEXT 1   // not binary, goes to the JSON line
+#define DDSM_BINCMD_FRAME 2  // completed a frame
+
+static inline size_t ddsm_bincmd_finish(uint8_t *out, uint8_t op, size_t args) {
+	out[0] = DDSM_BINCMD_SYNC;
+	out[1] = (uint8_t)args;
+	out[2] = op;
+	out[3 + args] = crc8_frame(out, 3 + args);
+	return 4 + args;
+}
+
+// setpoints of count motors (1 ~ DDSM_BINCMD_MAX) into out[DDSM_BINCMD_LENGTH].
+// returns the frame length, 0 if count is out of range.
+static inline size_t ddsm_encode_bincmd_ctrl(uint8_t *out, const ddsm_cmd *cmds, int count) {
+	if (count < 1 || count > DDSM_BINCMD_MAX) {
+		return 0;
+	}
+	for (int i = 0; i < count; i++) {
+		uint8_t *a = out + 3 + i * 4;
+		a[0] = cmds[i].id;
+		a[1] = (cmds[i].cmd >> 8) & 0xFF;
+		a[2] = cmds[i].cmd & 0xFF;
+		a[3] = cmds[i].act;
+	}
+	return ddsm_bincmd_finish(out, DDSM_BINCMD_CTRL, count * 4);
+}
+
+static inline size_t ddsm_encode_bincmd_stop(uint8_t *out, const uint8_t *ids, int count) {
+	if (count < 1 || count > DDSM_BINCMD_MAX) {
+		return 0;
+	}
+	for (int i = 0; i < count; i++) {
+		out[3 + i] = ids[i];
+	}
+	return ddsm_bincmd_finish(out, DDSM_BINCMD_STOP, count);
+}
+
+// bridge side: takes the command link byte by byte, picks the binary
+// frames out and hands every other byte back for the JSON line.
+// a frame that fails the CRC is dropped; a lost byte inside a frame
+// can take the start of the next JSON line with it, unless the link
+// goes quiet for DDSM_BINCMD_IDLE_US first.
+class DDSM_BINCMD_PARSER {
+public:
+	DDSM_BINCMD_PARSER();
+
+	void reset();
+
+	// b came in at now_us.
+	// returns DDSM_BINCMD_NONE / TEXT / FRAME.
+	int feed(uint8_t b, uint32_t now_us);
+
+	// the setpoints of the last frame, a stop is cmd 0, act 0.
+	// returns how many, 0 if the op is unknown or the length is wrong.
+	int cmds(ddsm_cmd *out, int max) const;
+
+	uint8_t op() const { return buf[2]; }
+
+	uint32_t frames;    // good frames
+	uint32_t errors;    // frames dropped on the CRC or length
+	uint32_t stale;     // frames dropped half way, the link went idle
+
+private:
+	uint8_t buf[DDSM_BINCMD_LENGTH];
+	size_t len;
+	uint32_t last_us;
+};
+
+#endif
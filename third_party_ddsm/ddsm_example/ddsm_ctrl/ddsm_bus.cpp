@@ -0,0 +1,237 @@
+#include "ddsm_bus.h"
+
+DDSM_BUS::DDSM_BUS()
+    : ctrl(nullptr),
+      motor_count(0),
+      period_us(10000),
+      info_every(50),
+      cycle(0),
+      plan_len(0),
+      plan_next(0),
+      in_flight(false),
+      cycle_start(0),
+      last_done(0),
+      window_start(0),
+      window_cycles(0),
+      cycle_hz(0),
+      cb(nullptr),
+      cb_arg(nullptr)
+{
+}
+
+// rate: target polling rate of every motor (Hz).
+void DDSM_BUS::begin(DDSM_CTRL *dc, uint16_t rate) {
+  ctrl = dc;
+  set_rate(rate);
+  cycle_start = micros();
+  last_done = cycle_start;
+  window_start = millis();
+}
+
+int DDSM_BUS::motor_index(uint8_t id) {
+  for (int i = 0; i < motor_count; i++) {
+    if (motors[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int DDSM_BUS::add_motor(uint8_t id) {
+  int i = motor_index(id);
+  if (i >= 0) {
+    return i;
+  }
+  if (motor_count >= DDSM_BUS_MAX_MOTORS) {
+    return -1;
+  }
+  ddsm_bus_motor &m = motors[motor_count];
+  m.id = id;
+  m.has_cmd = false;
+  m.cmd = 0;
+  m.act = 0;
+  m.polls = 0;
+  m.timeouts = 0;
+  m.crc_errors = 0;
+  m.rate_hz = 0;
+  return motor_count++;
+}
+
+// takes effect from the next cycle.
+int DDSM_BUS::remove_motor(uint8_t id) {
+  int i = motor_index(id);
+  if (i < 0) {
+    return -1;
+  }
+  for (int j = i; j < motor_count - 1; j++) {
+    motors[j] = motors[j + 1];
+  }
+  motor_count--;
+  return i;
+}
+
+void DDSM_BUS::set_rate(uint16_t rate) {
+  if (rate == 0) {
+    rate = 1;
+  }
+  period_us = 1000000UL / rate;
+}
+
+// 1: an info query for every motor every cycle.
+void DDSM_BUS::set_info_every(uint16_t cycles) {
+  info_every = cycles;
+}
+
+// setpoint sent with every ctrl frame of this motor.
+int DDSM_BUS::set_cmd(uint8_t id, int cmd, uint8_t act) {
+  int i = motor_index(id);
+  if (i < 0) {
+    return -1;
+  }
+  motors[i].cmd = cmd;
+  motors[i].act = act;
+  motors[i].has_cmd = true;
+  return i;
+}
+
+void DDSM_BUS::set_callback(ddsm_bus_callback callback, void *arg) {
+  cb = callback;
+  cb_arg = arg;
+}
+
+// the frames of one cycle, by motor id: remove_motor() shifts the
+// table while the plan runs.
+// info queries are spread over the cycles so only a few motors
+// get one in the same cycle.
+void DDSM_BUS::build_plan() {
+  plan_len = 0;
+  plan_next = 0;
+  for (int i = 0; i < motor_count; i++) {
+    if (motors[i].has_cmd) {
+      plan_id[plan_len] = motors[i].id;
+      plan_kind[plan_len] = DDSM_BUS_CTRL;
+      plan_len++;
+    }
+    bool info = !motors[i].has_cmd ||
+                (info_every > 0 && (cycle + i) % info_every == 0);
+    if (info) {
+      plan_id[plan_len] = motors[i].id;
+      plan_kind[plan_len] = DDSM_BUS_INFO;
+      plan_len++;
+    }
+  }
+  cycle++;
+  window_cycles++;
+}
+
+void DDSM_BUS::issue() {
+  int i = motor_index(plan_id[plan_next]);
+  if (i < 0) {
+    // removed since the plan was built.
+    plan_next++;
+    return;
+  }
+  ddsm_bus_motor &m = motors[i];
+  txn.bus = this;
+  txn.id = m.id;
+  txn.info = plan_kind[plan_next] == DDSM_BUS_INFO;
+  int handle;
+  if (!txn.info) {
+    handle = ctrl->begin_ctrl(m.id, m.cmd, m.act, on_txn, &txn);
+  } else {
+    handle = ctrl->begin_get_info(m.id, on_txn, &txn);
+  }
+  if (handle >= 0) {
+    in_flight = true;
+  }
+}
+
+// completion of the transaction on the bus, arg: its ddsm_bus_txn.
+void DDSM_BUS::on_txn(DDSM_CTRL *, int, int status, void *arg) {
+  const ddsm_bus_txn *t = (const ddsm_bus_txn *)arg;
+  DDSM_BUS *bus = t->bus;
+  bool info = t->info;
+  bus->in_flight = false;
+  bus->plan_next++;
+  bus->last_done = micros();
+
+  int idx = bus->motor_index(t->id);
+  if (idx >= 0) {
+    ddsm_bus_motor &m = bus->motors[idx];
+    if (status == DDSM_TXN_DONE) {
+      // the poll of the motor: its ctrl frame, or the info query
+      // of a motor without a setpoint.
+      if (!info || !m.has_cmd) {
+        m.polls++;
+      }
+    } else if (status == DDSM_TXN_TIMEOUT || status == DDSM_TXN_SHORT) {
+      m.timeouts++;
+    } else if (status == DDSM_TXN_CRC_ERR) {
+      m.crc_errors++;
+    }
+    if (bus->cb) {
+      bus->cb(bus, m.id, status, info, bus->cb_arg);
+    }
+  }
+}
+
+void DDSM_BUS::update_rates() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - window_start;
+  if (elapsed < DDSM_BUS_RATE_WINDOW) {
+    return;
+  }
+  for (int i = 0; i < motor_count; i++) {
+    motors[i].rate_hz = motors[i].polls * 1000.0f / elapsed;
+    motors[i].polls = 0;
+  }
+  cycle_hz = window_cycles * 1000.0f / elapsed;
+  window_cycles = 0;
+  window_start = now;
+}
+
+void DDSM_BUS::run() {
+  if (!ctrl) {
+    return;
+  }
+  ctrl->poll();
+  if (in_flight) {
+    return;
+  }
+
+  unsigned long now = micros();
+  if (plan_next >= plan_len) {
+    // cycle finished: wait for the next period, or start right away
+    // if the bus cannot keep up with the target rate.
+    if (now - cycle_start < period_us) {
+      update_rates();
+      return;
+    }
+    cycle_start = (now - cycle_start < 2 * period_us) ? cycle_start + period_us : now;
+    build_plan();
+    if (plan_len == 0) {
+      return;
+    }
+  }
+
+  if (now - last_done >= DDSM_FRAME_GAP_US) {
+    issue();
+  }
+  update_rates();
+}
+
+// answered polls per second of a motor over the last window: ctrl
+// replies, info replies for a motor without a setpoint (the periodic
+// info queries of the others are not counted).
+float DDSM_BUS::achieved_rate(uint8_t id) {
+  int i = motor_index(id);
+  if (i < 0) {
+    return 0;
+  }
+  return motors[i].rate_hz;
+}
+
+// completed cycles per second over the last window.
+float DDSM_BUS::cycle_rate() {
+  return cycle_hz;
+}
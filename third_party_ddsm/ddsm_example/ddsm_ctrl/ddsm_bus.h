@@ -0,0 +1,105 @@
+#ifndef _DDSM_BUS_H
+#define _DDSM_BUS_H
+
+#include "ddsm_ctrl.h"
+
+// max motors on one bus.
+#define DDSM_BUS_MAX_MOTORS 8
+
+// idle time after a reply before the next request (us).
+#define DDSM_FRAME_GAP_US 200
+
+// plan entry kinds.
+#define DDSM_BUS_CTRL 0
+#define DDSM_BUS_INFO 1
+
+// rate measurement window (ms).
+#define DDSM_BUS_RATE_WINDOW 1000
+
+class DDSM_BUS;
+
+// called for every completed transaction of the schedule.
+// info: 1 for a 0x74 reply, the decoded values are in bus->ctrl.
+typedef void (*ddsm_bus_callback)(DDSM_BUS *bus, uint8_t id, int status, bool info, void *arg);
+
+struct ddsm_bus_motor {
+	uint8_t id;
+	bool has_cmd;         // false: polled with info queries only
+	int cmd;
+	uint8_t act;
+	uint32_t polls;       // answered polls in the current window
+	uint32_t timeouts;    // total
+	uint32_t crc_errors;  // total
+	float rate_hz;        // answered polls per second, last window
+};
+
+// the transaction on the wire, the callback arg: the motor by id, its
+// index can change while the transaction is out (remove_motor).
+struct ddsm_bus_txn {
+	DDSM_BUS *bus;
+	uint8_t id;
+	bool info;
+};
+
+// bus scheduler.
+// owns the uart of a DDSM_CTRL and polls every registered motor once per
+// cycle: a ctrl frame (with the motor's setpoint) and, every info_every
+// cycles, an info query. frames go out back to back, separated only by
+// DDSM_FRAME_GAP_US after each reply.
+// limits: one transaction in flight at a time, so a cycle takes at least
+// the sum of the round trips plus a fixed DDSM_FRAME_GAP_US after each,
+// whatever the motors' actual turnaround. rates above that can't be
+// reached and the cycles run back to back (cycle_rate() tells).
+class DDSM_BUS {
+public:
+	DDSM_BUS();
+
+	void begin(DDSM_CTRL *dc, uint16_t rate);
+	int add_motor(uint8_t id);
+	int remove_motor(uint8_t id);
+	void set_rate(uint16_t rate);
+	void set_info_every(uint16_t cycles);
+	int set_cmd(uint8_t id, int cmd, uint8_t act);
+	void set_callback(ddsm_bus_callback cb, void *arg);
+
+	// call as often as possible from loop(), never blocks.
+	void run();
+
+	float achieved_rate(uint8_t id);
+	float cycle_rate();
+	int motor_index(uint8_t id);
+
+	DDSM_CTRL *ctrl;
+	ddsm_bus_motor motors[DDSM_BUS_MAX_MOTORS];
+	int motor_count;
+
+private:
+	static void on_txn(DDSM_CTRL *dc, int handle, int status, void *arg);
+	void build_plan();
+	void issue();
+	void update_rates();
+
+	uint32_t period_us;
+	uint16_t info_every;
+	uint32_t cycle;
+
+	ddsm_bus_txn txn;
+
+	uint8_t plan_id[DDSM_BUS_MAX_MOTORS * 2];
+	uint8_t plan_kind[DDSM_BUS_MAX_MOTORS * 2];
+	int plan_len;
+	int plan_next;
+	bool in_flight;
+
+	unsigned long cycle_start;
+	unsigned long last_done;
+
+	unsigned long window_start;
+	uint32_t window_cycles;
+	float cycle_hz;
+
+	ddsm_bus_callback cb;
+	void *cb_arg;
+};
+
+#endif
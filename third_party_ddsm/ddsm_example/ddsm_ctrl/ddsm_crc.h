@@ -0,0 +1,83 @@
+#ifndef _DDSM_CRC_H
+#define _DDSM_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// CRC-8/MAXIM (reflected poly 0x8c, init 0x00, no final xor).
+// every ddsm frame is 9 data bytes followed by this crc.
+// the 256-entry table is generated at compile time, so one lookup
+// replaces the 8 shift/xor steps per byte of the bitwise version.
+
+// one step of the bitwise algorithm.
+constexpr uint8_t crc8_bit_step(uint8_t crc) {
+  return (crc & 0x01) ? (uint8_t)((crc >> 1) ^ 0x8c) : (uint8_t)(crc >> 1);
+}
+
+// table entry for byte v: 8 bitwise steps.
+constexpr uint8_t crc8_table_entry(uint8_t v, int bits = 8) {
+  return bits == 0 ? v : crc8_table_entry(crc8_bit_step(v), bits - 1);
+}
+
+#define CRC8_E1(i)   crc8_table_entry((uint8_t)(i))
+#define CRC8_E4(i)   CRC8_E1(i), CRC8_E1((i) + 1), CRC8_E1((i) + 2), CRC8_E1((i) + 3)
+#define CRC8_E16(i)  CRC8_E4(i), CRC8_E4((i) + 4), CRC8_E4((i) + 8), CRC8_E4((i) + 12)
+#define CRC8_E64(i)  CRC8_E16(i), CRC8_E16((i) + 16), CRC8_E16((i) + 32), CRC8_E16((i) + 48)
+#define CRC8_E256(i) CRC8_E64(i), CRC8_E64((i) + 64), CRC8_E64((i) + 128), CRC8_E64((i) + 192)
+
+// the table lives in a class template so the header can be included
+// from several translation units (library + sketch) without an
+// out-of-line definition in a .cpp file.
+template <typename T = void>
+struct crc8_lut {
+  static constexpr uint8_t table[256] = { CRC8_E256(0) };
+};
+
+template <typename T>
+constexpr uint8_t crc8_lut<T>::table[256];
+
+#undef CRC8_E1
+#undef CRC8_E4
+#undef CRC8_E16
+#undef CRC8_E64
+#undef CRC8_E256
+
+static_assert(crc8_lut<>::table[0x01] == 0x5e, "CRC-8/MAXIM table");
+static_assert(crc8_lut<>::table[0x80] == 0x8c, "CRC-8/MAXIM table");
+
+// feed one byte into a running crc.
+static inline uint8_t crc8_update(uint8_t crc, uint8_t data) {
+  return crc8_lut<>::table[crc ^ data];
+}
+
+// crc of a whole buffer, e.g. crc8_frame(frame, 9) for a ddsm frame.
+static inline uint8_t crc8_frame(const uint8_t *data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; ++i) {
+    crc = crc8_lut<>::table[crc ^ data[i]];
+  }
+  return crc;
+}
+
+// true if the last byte of the frame is the crc of the bytes before it.
+static inline bool crc8_check(const uint8_t *frame, size_t frame_length) {
+  return crc8_frame(frame, frame_length - 1) == frame[frame_length - 1];
+}
+
+// verify count frames stored back to back.
+// valid (optional) gets 1/0 per frame.
+// returns the number of frames that passed.
+static inline size_t crc8_check_frames(const uint8_t *frames, size_t count,
+                                       size_t frame_length, uint8_t *valid = nullptr) {
+  size_t passed = 0;
+  for (size_t n = 0; n < count; ++n) {
+    bool ok = crc8_check(frames + n * frame_length, frame_length);
+    if (valid) {
+      valid[n] = ok ? 1 : 0;
+    }
+    passed += ok ? 1 : 0;
+  }
+  return passed;
+}
+
+#endif
@@ -1,41 +1,24 @@
 #include "ddsm_ctrl.h"
 
-// DDSM_CTRL::DDSM_CTRL() {
-// 	packet_length = 10;
-// 	packet_move[10] = {0x01, 0x64, 0xff, 0xce, 0x00, 0x00, 0x00, 0x00, 0x00, 0xda};
-// 	ddsm_type = TYPE_DDSM115;
-// 	get_info_flag = false;
-// }
-DDSM_CTRL::DDSM_CTRL() 
+DDSM_CTRL::DDSM_CTRL()
     : packet_length(10),  // Initialize const member in the initializer list
-      ddsm_type(TYPE_DDSM115), 
-      get_info_flag(false),
+      ddsm_type(TYPE_DDSM115),
+      retry_limit(0),
+      idle_fn(nullptr),
+      idle_arg(nullptr),
+      fifo_head(0),
+      fifo_count(0),
+      active(-1),
       pSerial(nullptr)
 {
-    packet_move[0] = 0x01;
-    packet_move[1] = 0x64;
-    packet_move[2] = 0xff;
-    packet_move[3] = 0xce;
-    packet_move[4] = 0x00;
-    packet_move[5] = 0x00;
-    packet_move[6] = 0x00;
-    packet_move[7] = 0x00;
-    packet_move[8] = 0x00;
-    packet_move[9] = 0xda;
-}
-
-// CRC-8/MAXIM
-uint8_t DDSM_CTRL::crc8_update(uint8_t crc, uint8_t data) {
-  uint8_t i;
-  crc = crc ^ data;
-  for (i = 0; i < 8; ++i) {
-    if (crc & 0x01) {
-      crc = (crc >> 1) ^ 0x8c;
-    } else {
-      crc >>= 1;
+    for (int i = 0; i < DDSM_TXN_QUEUE; i++) {
+      txns[i].status = DDSM_TXN_FREE;
     }
-  }
-  return crc;
+}
+
+// CRC-8/MAXIM, table driven (see ddsm_crc.h).
+uint8_t DDSM_CTRL::crc8_update(uint8_t crc, uint8_t data) {
+  return ::crc8_update(crc, data);
 }
 
 // config the type of ddsm.
@@ -50,197 +33,463 @@ int DDSM_CTRL::set_ddsm_type(int inputType) {
 	return -1;
 }
 
+// model of one motor id, 115/210 or TYPE_DDSM115/210, 0 removes it
+// (the id goes back to the set_ddsm_type() default).
+int DDSM_CTRL::set_model(uint8_t id, int inputType) {
+  uint8_t model = 0;
+  if (inputType == 115 || inputType == TYPE_DDSM115) {
+    model = TYPE_DDSM115;
+  } else if (inputType == 210 || inputType == TYPE_DDSM210) {
+    model = TYPE_DDSM210;
+  } else if (inputType != 0) {
+    return -1;
+  }
+  return models.set(id, model);
+}
+
+uint8_t DDSM_CTRL::model_of(uint8_t id) {
+  uint8_t model = models.get(id);
+  return model ? model : ddsm_type;
+}
+
 // clear ddsm serial buffer.
 void DDSM_CTRL::clear_ddsm_buffer() {
   while (pSerial->available() > 0) {
     pSerial->read();
   }
+  decoder.reset();
 }
 
-// feedback data from ddsm210
-int DDSM_CTRL::ddsm210_fb() {
-	unsigned long startTime = millis();
-
-	while (pSerial->available() <10) {
-		if (millis() - startTime >= TIME0UT) {
-			return -1;
-		}
-	}
-
-	uint8_t data[10];
-	pSerial->readBytes(data, 10);
+// move whatever the uart holds into the decoder window.
+void DDSM_CTRL::read_rx() {
+  int n = pSerial->available();
+  if (n <= 0) {
+    return;
+  }
+  size_t space = decoder.space();
+  if ((size_t)n > space) {
+    n = space;
+  }
+  decoder.commit(pSerial->readBytes(decoder.tail(), n));
+}
 
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, data[i]);
+// decode a feedback frame (crc already checked),
+// layouts in ddsm_driver.h.
+int DDSM_CTRL::parse_fb(const uint8_t *data, uint8_t model, bool info, ddsm_feedback *fb) {
+  if (model == TYPE_DDSM210) {
+    return DdsmDriver<Ddsm210>::decode(data, info, fb);
+  } else if (model == TYPE_DDSM115) {
+    return DdsmDriver<Ddsm115>::decode(data, info, fb);
   }
-  if (crc != data[9]){
+  return -1;
+}
+
+// decode a feedback frame into the telemetry table and the members.
+int DDSM_CTRL::decode_fb(const uint8_t *data, uint8_t model, bool info) {
+  ddsm_feedback fb;
+  if (parse_fb(data, model, info, &fb) < 0) {
     return -1;
   }
-  int feedback_type = data[1];
-  uint8_t ID = data[0];
+  uint32_t now = micros();
+  telemetry.update(fb, now);
+  odometry.update(fb, now);
+  estimator.update(fb, now);
 
-  if (feedback_type == 0x64) {
-    speed_data = (data[2] << 8) | data[3];
-    if (speed_data & 0x8000) {
-      speed_data = -(0x10000 - speed_data);
+  if (fb.fields & DDSM_FB_SPEED) {
+    speed_data = fb.speed;
+  }
+  if (fb.fields & DDSM_FB_CURRENT) {
+    if (model == TYPE_DDSM210) {
+      current = fb.current;
+    } else {
+      ddsm_torque = fb.current;
     }
+  }
+  if (fb.fields & DDSM_FB_ACC_TIME) {
+    acceleration_time = fb.acc_time;
+  }
+  if (fb.fields & DDSM_FB_TEMP) {
+    temperature = fb.temperature;
+  }
+  if (fb.fields & DDSM_FB_MODE) {
+    ddsm_mode = fb.mode;
+  }
+  if (fb.fields & DDSM_FB_U8) {
+    ddsm_u8 = fb.u8;
+  }
+  if (fb.fields & DDSM_FB_POS) {
+    ddsm_pos = fb.position;
+  }
+  if (fb.fields & DDSM_FB_MILEAGE) {
+    mileage = fb.mileage;
+  }
+  fault_code = fb.fault;
+  return 1;
+}
+
+// --- transactions ---
+// the bus is half duplex: one transaction is on the bus at a time,
+// the rest wait in a fifo. poll() never blocks.
 
-    current = (data[4] << 8) | data[5];
-    if (current & 0x8000) {
-      current = -(0x10000 - current);
+// take a free slot, copy the frame into it and append it to the fifo.
+// frame: nullptr to only wait for a reply.
+// the transaction starts with the next submit() / start_next().
+int DDSM_CTRL::queue_txn(const uint8_t *frame, bool expect_reply, uint8_t id, uint8_t model, bool info, ddsm_callback cb, void *arg) {
+  if (fifo_count >= DDSM_TXN_QUEUE) {
+    return -1;
+  }
+  int slot = -1;
+  for (int i = 0; i < DDSM_TXN_QUEUE; i++) {
+    if (txns[i].status == DDSM_TXN_FREE) {
+      slot = i;
+      break;
     }
+  }
+  if (slot < 0) {
+    return -1;
+  }
 
-    acceleration_time = data[6];
-    temperature = data[7];
-    fault_code = data[8];
-  } else if (feedback_type == 0x74) {
-    mileage = (int32_t)((uint32_t)data[2] << 24 | (uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | (uint32_t)data[5]);
-    ddsm_pos = (data[6] << 8) | data[7];
-    fault_code = data[8];
+  ddsm_txn &t = txns[slot];
+  if (frame) {
+    memcpy(t.frame, frame, packet_length);
   }
-  return 1;
+  t.send = frame != nullptr;
+  t.expect_reply = expect_reply;
+  t.id = id;
+  t.model = model;
+  t.info = info;
+  t.timeout = DDSM_RTT_DEFAULT_US;
+  t.hold_us = 0;
+  t.retries = (frame && expect_reply && id != 0) ? retry_limit : 0;
+  t.cb = cb;
+  t.arg = arg;
+  t.status = DDSM_TXN_QUEUED;
+
+  txn_fifo[(fifo_head + fifo_count) % DDSM_TXN_QUEUE] = slot;
+  fifo_count++;
+  return slot;
 }
 
-// feedback data from ddsm115.
-int DDSM_CTRL::ddsm115_fb() {
-	unsigned long startTime = millis();
+void DDSM_CTRL::set_retries(uint8_t count) {
+  retry_limit = count;
+}
 
-	while (pSerial->available() <10) {
-		if (millis() - startTime >= TIME0UT) {
-			return -1;
-		}
-	}
+// put a queued transaction on the wire right away if the bus is idle.
+int DDSM_CTRL::submit(int slot) {
+  start_next();
+  return slot;
+}
 
-  uint8_t data[10];
-  Serial1.readBytes(data, 10);
+int DDSM_CTRL::free_slots() {
+  int n = 0;
+  for (int i = 0; i < DDSM_TXN_QUEUE; i++) {
+    if (txns[i].status == DDSM_TXN_FREE) {
+      n++;
+    }
+  }
+  return n;
+}
 
-  uint8_t ddsm_id = data[0];
+// complete the active transaction.
+void DDSM_CTRL::finish_txn(int status) {
+  int slot = active;
+  active = -1;
+  ddsm_txn &t = txns[slot];
+  t.status = status;
+  if (t.cb) {
+    t.cb(this, slot, status, t.arg);
+    t.status = DDSM_TXN_FREE;
+  }
+}
 
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, data[i]);
+// start queued transactions until one is waiting for a reply.
+void DDSM_CTRL::start_next() {
+  while (active < 0 && fifo_count > 0) {
+    int slot = txn_fifo[fifo_head];
+    fifo_head = (fifo_head + 1) % DDSM_TXN_QUEUE;
+    fifo_count--;
+
+    ddsm_txn &t = txns[slot];
+    active = slot;
+    if (t.send) {
+      health.count(t.id, DDSM_HEALTH_REQUEST);
+      pSerial->write(t.frame, packet_length);
+      t.sent_at = micros();
+      if (rtt_kind(t) >= 0) {
+        t.timeout = rtt.timeout(t.id, rtt_kind(t));
+      }
+    }
+    if (t.expect_reply) {
+      t.status = DDSM_TXN_WAITING;
+      t.dropped_at = decoder.dropped;
+      if (!t.send) {
+        t.sent_at = micros();
+      }
+    } else if (t.hold_us > 0) {
+      // done once the hold time is over (poll()).
+      t.status = DDSM_TXN_WAITING;
+      t.timeout = t.hold_us;
+    } else {
+      finish_txn(DDSM_TXN_DONE);
+    }
   }
-  if (crc != data[9]){
+}
+
+// the active transaction failed: send it again if it has retries left,
+// otherwise complete it.
+void DDSM_CTRL::fail_txn(int status) {
+  ddsm_txn &t = txns[active];
+  int kind = status == DDSM_TXN_CRC_ERR ? DDSM_HEALTH_CRC_ERR :
+             status == DDSM_TXN_SHORT ? DDSM_HEALTH_SHORT : DDSM_HEALTH_TIMEOUT;
+  health.count(t.id, kind);
+  if (status != DDSM_TXN_CRC_ERR && rtt_kind(t) >= 0) {
+    rtt.lost(t.id, rtt_kind(t), t.sent_at);
+  }
+  if (t.retries > 0) {
+    t.retries--;
+    health.count(t.id, DDSM_HEALTH_RETRY);
+    health.count(t.id, DDSM_HEALTH_REQUEST);
+    // drop what is left of the bad reply.
+    decoder.reset();
+    pSerial->write(t.frame, packet_length);
+    t.sent_at = micros();
+    t.dropped_at = decoder.dropped;
+    t.timeout = rtt.timeout(t.id, rtt_kind(t));
+    return;
+  }
+  finish_txn(status);
+}
+
+// request kind for the round trip statistics, -1: not timed
+// (id check, read without request, no reply).
+int DDSM_CTRL::rtt_kind(const ddsm_txn &t) {
+  if (!t.send || !t.expect_reply || t.id == 0) {
     return -1;
   }
+  return t.info ? DDSM_RTT_INFO : DDSM_RTT_CTRL;
+}
 
-  ddsm_mode = data[1];
+// floor == ceil: fixed reply timeout.
+void DDSM_CTRL::set_timeout_limits(uint32_t floor_us, uint32_t ceil_us) {
+  rtt.set_limits(floor_us, ceil_us);
+}
 
-  ddsm_torque = (data[2] << 8) | data[3];
-  if (ddsm_torque & 0x8000) {
-    ddsm_torque = -(0x10000 - ddsm_torque);
+// advance the active transaction, never blocks.
+// every buffered frame is decoded, frames from other ids
+// (e.g. late replies of a timed out request) are skipped.
+void DDSM_CTRL::poll() {
+  read_rx();
+
+  uint8_t frame[10];
+  while (decoder.next(frame)) {
+    bool matched = false;
+    if (active >= 0) {
+      ddsm_txn &t = txns[active];
+      if (t.expect_reply && (t.id == 0 || frame[0] == t.id)) {
+        memcpy(t.reply, frame, packet_length);
+        decode_fb(t.reply, t.model, t.info);
+        health.count(t.id, DDSM_HEALTH_REPLY);
+        if (rtt_kind(t) >= 0) {
+          rtt.sample(t.id, rtt_kind(t), micros() - t.sent_at);
+        }
+        finish_txn(DDSM_TXN_DONE);
+        // the reply is over, the bus is free for the next frame.
+        start_next();
+        matched = true;
+      }
+    }
+    if (!matched) {
+      health.count(frame[0], DDSM_HEALTH_UNEXPECTED);
+      rtt.late(frame[0], micros());
+    }
   }
 
-  speed_data = (data[4] << 8) | data[5];
-  if (speed_data & 0x8000) {
-    speed_data = -(0x10000 - speed_data);
+  if (active >= 0 && !txns[active].expect_reply) {
+    if (micros() - txns[active].sent_at >= txns[active].timeout) {
+      finish_txn(DDSM_TXN_DONE);
+    }
+  } else if (active >= 0) {
+    ddsm_txn &t = txns[active];
+    // a whole frame of bytes failed the CRC since the request went out.
+    bool corrupt = decoder.dropped - t.dropped_at >= packet_length;
+    if (corrupt) {
+      fail_txn(DDSM_TXN_CRC_ERR);
+    } else if (micros() - t.sent_at >= t.timeout) {
+      if (decoder.dropped != t.dropped_at) {
+        fail_txn(DDSM_TXN_CRC_ERR);
+      } else if (decoder.buffered() > 0) {
+        fail_txn(DDSM_TXN_SHORT);
+      } else {
+        fail_txn(DDSM_TXN_TIMEOUT);
+      }
+    }
   }
+  start_next();
+}
 
-  if (get_info_flag) {
-    get_info_flag = false;
-    temperature = data[6];
-    ddsm_u8 = data[7];
-    fault_code = data[8];
-  } else {
-    ddsm_pos = (data[6] << 8) | data[7];
-    fault_code = data[8];
-  }
-  return 1;
+void DDSM_CTRL::set_idle(ddsm_idle_fn fn, void *arg) {
+  idle_fn = fn;
+  idle_arg = arg;
 }
 
+uint32_t DDSM_CTRL::idle_us() {
+  if (active < 0) {
+    return 0;
+  }
+  ddsm_txn &t = txns[active];
+  uint32_t elapsed = micros() - t.sent_at;
+  return elapsed >= t.timeout ? 0 : t.timeout - elapsed;
+}
 
-// check the ID of ddsm.
-int DDSM_CTRL::ddsm_id_check() {
-	packet_move[0] = 0xC8;
-	packet_move[1] = 0x64;
-	packet_move[2] = 0x00;
-	packet_move[3] = 0x00;
-
-	packet_move[4] = 0x00;
-	packet_move[5] = 0x00;
-	packet_move[6] = 0x00;
-	packet_move[7] = 0x00;
-
-	packet_move[8] = 0x00;
-	packet_move[9] = 0xDE;
-	pSerial->write(packet_move, packet_length);
-
-	unsigned long startTime = millis();
-
-	while (pSerial->available() <10) {
-		if (millis() - startTime >= TIME0UT) {
-			return -1;
-		}
-	}
+// one step of a blocking wait: poll, then let the idle hook
+// sleep until the next byte or timeout.
+void DDSM_CTRL::poll_wait() {
+  poll();
+  if (idle_fn) {
+    uint32_t us = idle_us();
+    if (us > 0) {
+      idle_fn(this, us, idle_arg);
+    }
+  }
+}
 
-	uint8_t data[10];
-	pSerial->readBytes(data, 10);
+int DDSM_CTRL::txn_status(int handle) {
+  if (handle < 0 || handle >= DDSM_TXN_QUEUE) {
+    return -1;
+  }
+  return txns[handle].status;
+}
 
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, data[i]);
+// raw reply of a completed transaction.
+const uint8_t *DDSM_CTRL::txn_reply(int handle) {
+  if (handle < 0 || handle >= DDSM_TXN_QUEUE) {
+    return nullptr;
   }
-  if (crc != data[9]){
-    return -1;
+  return txns[handle].reply;
+}
+
+const ddsm_txn *DDSM_CTRL::txn_entry(int handle) {
+  if (handle < 0 || handle >= DDSM_TXN_QUEUE) {
+    return nullptr;
   }
-  int feedback_type = data[1];
-  uint8_t ID = data[0];
-  return ID;
+  return &txns[handle];
 }
 
-int DDSM_CTRL::ddsm_change_id(uint8_t id) {
-	packet_move[0] = 0xAA;
+// free a completed transaction slot.
+void DDSM_CTRL::txn_release(int handle) {
+  if (handle < 0 || handle >= DDSM_TXN_QUEUE) {
+    return;
+  }
+  if (txns[handle].status >= DDSM_TXN_DONE) {
+    txns[handle].status = DDSM_TXN_FREE;
+  }
+}
 
-	packet_move[1] = 0x55;
-	packet_move[2] = 0x53;
+// number of transactions queued or on the bus.
+int DDSM_CTRL::txn_pending() {
+  return fifo_count + (active >= 0 ? 1 : 0);
+}
 
-	packet_move[3] = id;
+// oldest first, the active transaction stays.
+int DDSM_CTRL::cancel_queued(int count) {
+  int n = 0;
+  while (fifo_count > 0 && (count < 0 || n < count)) {
+    int slot = txn_fifo[fifo_head];
+    fifo_head = (fifo_head + 1) % DDSM_TXN_QUEUE;
+    fifo_count--;
+    ddsm_txn &t = txns[slot];
+    t.status = DDSM_TXN_DROPPED;
+    if (t.cb) {
+      t.cb(this, slot, DDSM_TXN_DROPPED, t.arg);
+      t.status = DDSM_TXN_FREE;
+    }
+    n++;
+  }
+  return n;
+}
 
-	packet_move[4] = 0x00;
-	packet_move[5] = 0x00;
-	packet_move[6] = 0x00;
-	packet_move[7] = 0x00;
-	packet_move[8] = 0x00;
+// poll until the transaction completes, release it and return its status.
+// only for handles without a callback.
+int DDSM_CTRL::wait(int handle) {
+  if (handle < 0 || handle >= DDSM_TXN_QUEUE) {
+    return -1;
+  }
+  while (txns[handle].status == DDSM_TXN_QUEUED || txns[handle].status == DDSM_TXN_WAITING) {
+    poll_wait();
+  }
+  int status = txns[handle].status;
+  txn_release(handle);
+  return status;
+}
 
-	// CRC-8/MAXIM
-	uint8_t crc = 0;
-	for (size_t i = 0; i < packet_length - 1; ++i) {
-		crc = crc8_update(crc, packet_move[i]);
-	}
-	packet_move[9] = crc;
+// wait for a feedback frame without sending anything.
+int DDSM_CTRL::begin_read(uint8_t model, ddsm_callback cb, void *arg) {
+  return submit(queue_txn(nullptr, true, 0, model, false, cb, arg));
+}
 
-	for (int i = 0;i < 5;i++) {
-		pSerial->write(packet_move, packet_length);
-		delay(TIME_BETWEEN_CMD);
-	}
+// feedback data from ddsm210
+int DDSM_CTRL::ddsm210_fb() {
+  return wait(begin_read(TYPE_DDSM210)) == DDSM_TXN_DONE ? 1 : -1;
+}
 
-	ddsm_id_check();
-	unsigned long startTime = millis();
+// feedback data from ddsm115.
+int DDSM_CTRL::ddsm115_fb() {
+  return wait(begin_read(TYPE_DDSM115)) == DDSM_TXN_DONE ? 1 : -1;
+}
 
-	while (pSerial->available() <10) {
-		if (millis() - startTime >= TIME0UT) {
-			return -1;
-		}
-	}
 
-	uint8_t data[10];
-	pSerial->readBytes(data, 10);
+// check the ID of ddsm.
+// there must be only one ddsm connected.
+int DDSM_CTRL::begin_id_check(ddsm_callback cb, void *arg) {
+	uint8_t f[10];
+	ddsm_encode_id_check(f);
+	return submit(queue_txn(f, true, 0, 0, false, cb, arg));
+}
 
-  // CRC-8/MAXIM
-  crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, data[i]);
+int DDSM_CTRL::ddsm_id_check() {
+  int handle = begin_id_check();
+  if (handle < 0) {
+    return -1;
   }
-  if (crc != data[9]){
+  while (txn_status(handle) == DDSM_TXN_QUEUED || txn_status(handle) == DDSM_TXN_WAITING) {
+    poll_wait();
+  }
+  int status = txn_status(handle);
+  int ID = txn_reply(handle)[0];
+  txn_release(handle);
+  if (status != DDSM_TXN_DONE) {
     return -1;
   }
-  int feedback_type = data[1];
-  uint8_t ID = data[0];
+  return ID;
+}
+
+// callback of the repeats before the last one: frees their slots.
+static void change_id_repeat(DDSM_CTRL *, int, int, void *) {
+}
 
+// the repeats are queued together, all or none, each one holds the
+// bus for TIME_BETWEEN_CMD. returns the handle of the last one.
+int DDSM_CTRL::begin_change_id(uint8_t id, ddsm_callback cb, void *arg) {
+  if (free_slots() < DDSM_CHANGE_ID_REPEAT || fifo_count + DDSM_CHANGE_ID_REPEAT > DDSM_TXN_QUEUE) {
+    return -1;
+  }
+  uint8_t f[10];
+  ddsm_encode_change_id(f, id);
+  int slot = -1;
+  for (int i = 0; i < DDSM_CHANGE_ID_REPEAT; i++) {
+    bool last = i == DDSM_CHANGE_ID_REPEAT - 1;
+    slot = queue_txn(f, false, 0, 0, false, last ? cb : change_id_repeat, last ? arg : nullptr);
+    txns[slot].hold_us = TIME_BETWEEN_CMD * 1000UL;
+  }
+  return submit(slot);
+}
+
+// the id frame is not acknowledged,
+// the new id is confirmed with an id check afterwards.
+int DDSM_CTRL::ddsm_change_id(uint8_t id) {
+  wait(begin_change_id(id));
+
+  int ID = ddsm_id_check();
   if (id != ID) {
   	return -1;
   } else {
@@ -248,6 +497,53 @@ int DDSM_CTRL::ddsm_change_id(uint8_t id) {
   }
 }
 
+// short-gap sequential scan: a probe goes out as soon as the reply of the one
+// before is in or had time to be, so absent ids cost ~2.4ms each
+// instead of a timeout.
+int DDSM_CTRL::discover(uint8_t first, uint8_t last, ddsm_motor *table, int max) {
+  while (txn_pending() > 0) {
+    poll_wait();
+  }
+
+  const ddsm_rtt_stats &known = rtt.bus[DDSM_RTT_INFO];
+  DDSM_DISCOVER scan;
+  scan.begin(first, last, known.samples >= DDSM_RTT_MIN_SAMPLES ? (uint32_t)known.p99_us : 0,
+             rtt.timeout(0, DDSM_RTT_INFO));
+
+  // probes aren't counted in health, absent ids would fill its rows.
+  uint8_t f[10];
+  for (;;) {
+    read_rx();
+    while (decoder.next(f)) {
+      int k = scan.reply(f, micros());
+      if (k < 0) {
+        health.count(f[0], DDSM_HEALTH_UNEXPECTED);
+        continue;
+      }
+      const ddsm_motor &m = scan.found[k];
+      models.set(m.id, m.model);
+      decode_fb(f, m.model, true);
+      if (m.rtt_us > 0) {
+        rtt.sample(m.id, DDSM_RTT_INFO, m.rtt_us);
+      }
+    }
+    int id = scan.next_probe(micros(), decoder.buffered() > 0);
+    if (id < 0) {
+      break;
+    }
+    if (id > 0) {
+      ddsm_encode_info(f, id);
+      pSerial->write(f, packet_length);
+    }
+  }
+
+  int n = scan.count < max ? scan.count : max;
+  for (int i = 0; i < n; i++) {
+    table[i] = scan.found[i];
+  }
+  return n;
+}
+
 // change mode
 // ddsm115:
 // 1 - current loop
@@ -258,36 +554,19 @@ int DDSM_CTRL::ddsm_change_id(uint8_t id) {
 // 0 - open loop
 // 2 - speed loop
 // 3 - position loop
-void DDSM_CTRL::ddsm_change_mode(uint8_t id, uint8_t mode) {
-  if (ddsm_type == TYPE_DDSM115) {
-    packet_move[0] = id;
-    packet_move[1] = 0xA0;
-    packet_move[2] = 0x00;
-    packet_move[3] = 0x00;
-    packet_move[4] = 0x00;
-    packet_move[5] = 0x00;
-    packet_move[6] = 0x00;
-    packet_move[7] = 0x00;
-    packet_move[8] = 0x00;
-    packet_move[9] = mode;
-  } else if (ddsm_type == TYPE_DDSM210) {
-    packet_move[0] = id;
-    packet_move[1] = 0xA0;
-    packet_move[2] = mode;
-    packet_move[3] = 0x00; 
-    packet_move[4] = 0x00;
-    packet_move[5] = 0x00;
-    packet_move[6] = 0x00;
-    packet_move[7] = 0x00;
-    packet_move[8] = 0x00;
-    // CRC-8/MAXIM
-    uint8_t crc = 0;
-    for (size_t i = 0; i < packet_length - 1; ++i) {
-      crc = crc8_update(crc, packet_move[i]);
-    }
-    packet_move[9] = crc;
+int DDSM_CTRL::begin_change_mode(uint8_t id, uint8_t mode, ddsm_callback cb, void *arg) {
+  uint8_t f[10];
+  uint8_t model = model_of(id);
+  if (model == TYPE_DDSM115) {
+    DdsmDriver<Ddsm115>::encode_mode(f, id, mode);
+  } else {
+    DdsmDriver<Ddsm210>::encode_mode(f, id, mode);
   }
-  pSerial->write(packet_move, packet_length);
+  return submit(queue_txn(f, false, id, model, false, cb, arg));
+}
+
+void DDSM_CTRL::ddsm_change_mode(uint8_t id, uint8_t mode) {
+  wait(begin_change_mode(id, mode));
 }
 
 // --- DDSM115 ---
@@ -303,68 +582,113 @@ void DDSM_CTRL::ddsm_change_mode(uint8_t id, uint8_t mode) {
 //    wherever the mode is set to position mode
 //    the currently position is the 0 position and it moves to the goal position
 //    at the direction as the shortest path.
-void DDSM_CTRL::ddsm_ctrl(uint8_t id, int cmd, uint8_t act) {
-  packet_move[0] = id;
-  packet_move[1] = 0x64;
-
-  packet_move[2] = (cmd >> 8) & 0xFF;
-  packet_move[3] = cmd & 0xFF;
-
-  packet_move[4] = 0x00;
-  packet_move[5] = 0x00;
+int DDSM_CTRL::begin_ctrl(uint8_t id, int cmd, uint8_t act, ddsm_callback cb, void *arg) {
+  uint8_t f[10];
+  ddsm_encode_ctrl(f, id, cmd, act);
+  return submit(queue_txn(f, true, id, model_of(id), false, cb, arg));
+}
 
-  packet_move[6] = act;
-  packet_move[7] = 0x00;
+void DDSM_CTRL::ddsm_ctrl(uint8_t id, int cmd, uint8_t act) {
+  wait(begin_ctrl(id, cmd, act));
+}
 
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, packet_move[i]);
+// queue count transactions one after the other in the fifo, all or
+// none: ctrl frames of cmds, or info queries of ids (cmds nullptr).
+// each frame is encoded into its own slot, start_next() sends it when
+// the transaction before it is over. the bus is half duplex, the frames
+// are written one at a time, never as one block.
+int DDSM_CTRL::queue_burst(const ddsm_cmd *cmds, const uint8_t *ids, int count, ddsm_callback cb, void *arg, int *handles) {
+  if (count <= 0 || count > free_slots() || fifo_count + count > DDSM_TXN_QUEUE) {
+    return -1;
   }
-  packet_move[9] = crc;
+  for (int i = 0; i < count; i++) {
+    uint8_t f[DDSM_FRAME_LENGTH];
+    uint8_t id;
+    if (cmds) {
+      id = cmds[i].id;
+      ddsm_encode_ctrl(f, id, cmds[i].cmd, cmds[i].act);
+    } else {
+      id = ids[i];
+      ddsm_encode_info(f, id);
+    }
+    int slot = queue_txn(f, true, id, model_of(id), cmds == nullptr, cb, arg);
+    if (handles) {
+      handles[i] = slot;
+    }
+  }
+  start_next();
+  return count;
+}
 
-  pSerial->write(packet_move, packet_length);
+// setpoints of several motors as close together as the half duplex
+// bus allows: one frame and its reply after the other, nothing queued
+// in between.
+int DDSM_CTRL::begin_ctrl_burst(const ddsm_cmd *cmds, int count, ddsm_callback cb, void *arg, int *handles) {
+  return queue_burst(cmds, nullptr, count, cb, arg, handles);
+}
 
-  ddsm210_fb();
+// returns the number of motors that answered.
+int DDSM_CTRL::ddsm_ctrl_burst(const ddsm_cmd *cmds, int count) {
+  int handles[DDSM_TXN_QUEUE];
+  if (begin_ctrl_burst(cmds, count, nullptr, nullptr, handles) < 0) {
+    return -1;
+  }
+  int ok = 0;
+  for (int i = 0; i < count; i++) {
+    if (wait(handles[i]) == DDSM_TXN_DONE) {
+      ok++;
+    }
+  }
+  return ok;
 }
 
-void DDSM_CTRL::ddsm_get_info(uint8_t id) {  
-  packet_move[0] = id;
+// temperature / mileage of every motor, one query and its reply after
+// the other: a reply overlapping the next query would garble both on
+// the half duplex bus. a motor that doesn't answer costs its timeout.
+int DDSM_CTRL::begin_get_info_all(const uint8_t *ids, int count, ddsm_callback cb, void *arg, int *handles) {
+  return queue_burst(nullptr, ids, count, cb, arg, handles);
+}
 
-  if (ddsm_type == TYPE_DDSM115) {
-    get_info_flag = true;
+int DDSM_CTRL::get_info_all(const uint8_t *ids, int count, ddsm_info *out) {
+  int ok = 0;
+  for (int base = 0; base < count; base += DDSM_TXN_QUEUE) {
+    int n = count - base < DDSM_TXN_QUEUE ? count - base : DDSM_TXN_QUEUE;
+    int handles[DDSM_TXN_QUEUE];
+    if (begin_get_info_all(ids + base, n, nullptr, nullptr, handles) < 0) {
+      return -1;
+    }
+    for (int i = 0; i < n; i++) {
+      int h = handles[i];
+      while (txn_status(h) == DDSM_TXN_QUEUED || txn_status(h) == DDSM_TXN_WAITING) {
+        poll_wait();
+      }
+      ddsm_info &r = out[base + i];
+      r.id = ids[base + i];
+      r.status = txn_status(h);
+      memset(&r.fb, 0, sizeof(r.fb));
+      if (r.status == DDSM_TXN_DONE && parse_fb(txn_reply(h), txns[h].model, true, &r.fb) >= 0) {
+        ok++;
+      }
+      txn_release(h);
+    }
   }
+  return ok;
+}
 
-  packet_move[1] = 0x74;
-
-  packet_move[2] = 0x00;
-  packet_move[3] = 0x00;
+int DDSM_CTRL::begin_get_info(uint8_t id, ddsm_callback cb, void *arg) {
+  uint8_t f[10];
+  ddsm_encode_info(f, id);
+  return submit(queue_txn(f, true, id, model_of(id), true, cb, arg));
+}
 
-  packet_move[4] = 0x00;
-  packet_move[5] = 0x00;
-  packet_move[6] = 0x00;
-  packet_move[7] = 0x00;
+void DDSM_CTRL::ddsm_get_info(uint8_t id) {
+  wait(begin_get_info(id));
+}
 
-  packet_move[8] = 0x00;
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, packet_move[i]);
-  }
-  packet_move[9] = crc;
-  pSerial->write(packet_move, packet_length);
-  if (ddsm_type == TYPE_DDSM115) {
-  	ddsm115_fb();
-  } else if (ddsm_type == TYPE_DDSM210) {
-  	ddsm210_fb();
-  }
+int DDSM_CTRL::begin_stop(uint8_t id, ddsm_callback cb, void *arg) {
+  return begin_ctrl(id, 0, 0, cb, arg);
 }
 
 void DDSM_CTRL::ddsm_stop(uint8_t id) {
-	ddsm_ctrl(id, 0, 0);
-  if (ddsm_type == TYPE_DDSM115) {
-  	ddsm115_fb();
-  } else if (ddsm_type == TYPE_DDSM210) {
-  	ddsm210_fb();
-  }
-}
\ No newline at end of file
+  wait(begin_stop(id));
+}
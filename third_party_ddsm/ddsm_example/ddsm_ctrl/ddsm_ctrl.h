@@ -3,43 +3,229 @@
 
 #if defined(ARDUINO) && ARDUINO >= 100
 #include "Arduino.h"
+#elif defined(DDSM_HOST)
+#include "ddsm_host.h"
 #else
 #include "WProgram.h"
 #endif
 
+#include "ddsm_crc.h"
+#include "ddsm_decoder.h"
+#include "ddsm_discover.h"
+#include "ddsm_driver.h"
+#include "ddsm_estimator.h"
+#include "ddsm_health.h"
+#include "ddsm_models.h"
+#include "ddsm_odometry.h"
+#include "ddsm_rtt.h"
+#include "ddsm_telemetry.h"
+
 #define DDSM_BAUDRATE 115200
 
-#define TYPE_DDSM115  1
-#define TYPE_DDSM210  2
 #define TIME_BETWEEN_CMD 4
-#define TIME0UT 4
+// the motor takes a new id only from a repeated frame.
+#define DDSM_CHANGE_ID_REPEAT 5
+#define TIME0UT 4 // ms, see DDSM_RTT_DEFAULT_US
+
+// max number of queued/in-flight transactions: a batch of 8 motors
+// fits next to a full burst of setpoints.
+#define DDSM_TXN_QUEUE 16
+
+// transaction status.
+#define DDSM_TXN_FREE     0 // slot unused
+#define DDSM_TXN_QUEUED   1 // waiting for the bus
+#define DDSM_TXN_WAITING  2 // frame sent, waiting for the reply
+#define DDSM_TXN_DONE     3 // reply received (or no reply expected)
+#define DDSM_TXN_TIMEOUT  4 // no reply within the timeout
+#define DDSM_TXN_CRC_ERR  5 // reply failed CRC
+#define DDSM_TXN_SHORT    6 // less than a frame came back
+#define DDSM_TXN_DROPPED  7 // taken off the queue unsent (cancel_queued)
+
+class DDSM_CTRL;
+
+// called from poll() when a transaction completes.
+// status: DDSM_TXN_DONE / DDSM_TXN_TIMEOUT / DDSM_TXN_CRC_ERR / DDSM_TXN_SHORT
+// / DDSM_TXN_DROPPED
+typedef void (*ddsm_callback)(DDSM_CTRL *dc, int handle, int status, void *arg);
+
+// called by the blocking methods between two poll()s while a reply is
+// due, wait_us: time left until it times out. may sleep until the uart
+// has data or that time passed (see extras/host/ddsm_linux.h).
+typedef void (*ddsm_idle_fn)(DDSM_CTRL *dc, uint32_t wait_us, void *arg);
+
+// one request/response exchange on the bus.
+struct ddsm_txn {
+	uint8_t frame[10];     // request, empty when only waiting for a reply
+	uint8_t reply[10];     // raw reply frame
+	uint8_t id;            // expected reply id, 0: any
+	uint8_t send;          // 1: write frame before waiting
+	uint8_t expect_reply;  // 1: wait for a 10-byte reply
+	uint8_t model;         // layout used to decode the reply (TYPE_DDSM115/210)
+	uint8_t info;          // 1: reply is an info (0x74) frame
+	uint8_t status;
+	uint32_t timeout;      // us
+	uint32_t hold_us;      // no reply expected: the bus stays idle this long after the frame
+	uint8_t retries;       // retries left
+	unsigned long sent_at; // micros()
+	uint32_t dropped_at;   // decoder.dropped when the frame was sent
+	ddsm_callback cb;      // nullptr: caller polls txn_status()
+	void *arg;
+};
 
+// one motor of get_info_all().
+struct ddsm_info {
+	uint8_t id;
+	uint8_t status;        // DDSM_TXN_DONE / TIMEOUT / CRC_ERR / SHORT
+	ddsm_feedback fb;      // decoded info reply, zero unless DDSM_TXN_DONE
+};
 
+// runtime front end for either model.
+// frames are built and parsed by DdsmDriver<Ddsm115/Ddsm210>
+// (ddsm_driver.h), picked by set_ddsm_type() or the transaction.
 class DDSM_CTRL{
 public:
 	DDSM_CTRL();
 
-	virtual void clear_ddsm_buffer();
-	virtual uint8_t crc8_update(uint8_t crc, uint8_t data);
-	virtual int set_ddsm_type(int inputType);
-	virtual int ddsm_id_check();
-	virtual int ddsm_change_id(uint8_t id);
-	virtual void ddsm_change_mode(uint8_t id, uint8_t mode);
-	virtual void ddsm_ctrl(uint8_t id, int cmd, uint8_t act);
-	virtual void ddsm_get_info(uint8_t id);
-	virtual void ddsm_stop(uint8_t id);
-	virtual int ddsm210_fb();
-	virtual int ddsm115_fb();
+	void clear_ddsm_buffer();
+	uint8_t crc8_update(uint8_t crc, uint8_t data);
+	int set_ddsm_type(int inputType);
+
+	// per-id model, for a bus with both ddsm115s and ddsm210s.
+	// frames to and from an id in the table use its model, any other id
+	// uses the set_ddsm_type() one. discover() fills the table too.
+	int set_model(uint8_t id, int inputType);
+	uint8_t model_of(uint8_t id);
+	int ddsm_id_check();
+	int ddsm_change_id(uint8_t id);
+	void ddsm_change_mode(uint8_t id, uint8_t mode);
+	void ddsm_ctrl(uint8_t id, int cmd, uint8_t act);
+	void ddsm_get_info(uint8_t id);
+	void ddsm_stop(uint8_t id);
+	int ddsm210_fb();
+	int ddsm115_fb();
+
+	// find the motors with ids first..last (see ddsm_discover.h).
+	// waits for the queued transactions, then blocks for about 2.4ms
+	// per id. table receives up to max motors, returns how many answered.
+	// the models found go into the per-id table.
+	int discover(uint8_t first, uint8_t last, ddsm_motor *table, int max);
+
+	// non-blocking api.
+	// begin_*() queue a frame and return a handle (-1 if the queue is full),
+	// poll() drives the bus and completes transactions.
+	// without a callback the handle stays valid until txn_release().
+	int begin_ctrl(uint8_t id, int cmd, uint8_t act, ddsm_callback cb = nullptr, void *arg = nullptr);
+	int begin_get_info(uint8_t id, ddsm_callback cb = nullptr, void *arg = nullptr);
+	int begin_stop(uint8_t id, ddsm_callback cb = nullptr, void *arg = nullptr);
+	int begin_change_mode(uint8_t id, uint8_t mode, ddsm_callback cb = nullptr, void *arg = nullptr);
+	// the id frame DDSM_CHANGE_ID_REPEAT times, TIME_BETWEEN_CMD apart,
+	// no reply. cb is called once, after the last one.
+	int begin_change_id(uint8_t id, ddsm_callback cb = nullptr, void *arg = nullptr);
+	int begin_id_check(ddsm_callback cb = nullptr, void *arg = nullptr);
+	int begin_read(uint8_t model, ddsm_callback cb = nullptr, void *arg = nullptr);
+
+	// ctrl frames for several motors, queued together so nothing else
+	// gets in between. the bus is half duplex, a motor answers right
+	// after its frame, so each frame goes out once the reply before it
+	// is in (or timed out), never on top of a reply.
+	// every command is its own transaction, handles[i] (optional)
+	// receives the handle of cmds[i]. returns count, -1 if the queue
+	// has no room for all of them (nothing is queued then).
+	int begin_ctrl_burst(const ddsm_cmd *cmds, int count, ddsm_callback cb = nullptr, void *arg = nullptr, int *handles = nullptr);
+	int ddsm_ctrl_burst(const ddsm_cmd *cmds, int count);
+
+	// info (0x74) queries of several motors queued together, sequential
+	// like begin_ctrl_burst(): one query and its reply at a time, the
+	// next goes out once the reply before it is in (or timed out). no
+	// faster than begin_get_info() per motor, it only keeps other
+	// requests out from between the queries.
+	// same return and handles as begin_ctrl_burst().
+	int begin_get_info_all(const uint8_t *ids, int count, ddsm_callback cb = nullptr, void *arg = nullptr, int *handles = nullptr);
+	// blocking, out[i] receives the reply of ids[i]. more ids than
+	// DDSM_TXN_QUEUE are queued DDSM_TXN_QUEUE at a time. returns the number of motors
+	// that answered, -1 if the queue is busy.
+	int get_info_all(const uint8_t *ids, int count, ddsm_info *out);
+	void poll();
+	int txn_status(int handle);
+	const uint8_t *txn_reply(int handle);
+	// the whole transaction (request, reply, model, sent_at), valid in
+	// its callback or until txn_release().
+	const ddsm_txn *txn_entry(int handle);
+	void txn_release(int handle);
+	int txn_pending();
+	int wait(int handle);
+
+	// take up to count (-1: all) of the oldest transactions that are not
+	// on the wire yet off the queue, each completes as DDSM_TXN_DROPPED.
+	// returns how many were dropped.
+	int cancel_queued(int count = -1);
+
+	// resend a ctrl or info request up to count times when its reply
+	// times out or fails the CRC (0: off, default). both are idempotent,
+	// a repeated setpoint or query has no extra effect.
+	void set_retries(uint8_t count);
+
+	// nullptr: the blocking methods spin on poll() (default).
+	void set_idle(ddsm_idle_fn fn, void *arg = nullptr);
+	// us until the active transaction times out, 0: nothing to wait for.
+	uint32_t idle_us();
+
+	// reply timeouts follow the measured round trip of every motor and
+	// request kind, within these limits (see ddsm_rtt.h).
+	void set_timeout_limits(uint32_t floor_us, uint32_t ceil_us);
 
 private:
-	const size_t packet_length;   
-	uint8_t packet_move[10];
+	int queue_txn(const uint8_t *frame, bool expect_reply, uint8_t id, uint8_t model, bool info, ddsm_callback cb, void *arg);
+	int submit(int slot);
+	int free_slots();
+	void start_next();
+	int queue_burst(const ddsm_cmd *cmds, const uint8_t *ids, int count, ddsm_callback cb, void *arg, int *handles);
+	int rtt_kind(const ddsm_txn &t);
+	void finish_txn(int status);
+	void fail_txn(int status);
+	void read_rx();
+	void poll_wait();
+	int parse_fb(const uint8_t *data, uint8_t model, bool info, ddsm_feedback *fb);
+	int decode_fb(const uint8_t *data, uint8_t model, bool info);
+
+	const size_t packet_length;
 	uint8_t ddsm_type;
-	bool get_info_flag;
+	uint8_t retry_limit;
+	ddsm_idle_fn idle_fn;
+	void *idle_arg;
+
+	ddsm_txn txns[DDSM_TXN_QUEUE];
+	uint8_t txn_fifo[DDSM_TXN_QUEUE];
+	uint8_t fifo_head;
+	uint8_t fifo_count;
+	int active; // slot on the bus, -1 if idle
 
 public:
 	HardwareSerial *pSerial;
-	
+	DDSM_DECODER decoder;
+
+	// per-motor state, updated from every reply.
+	// read it from any task with telemetry.snapshot().
+	DDSM_TELEMETRY telemetry;
+
+	// per-motor timeouts, crc errors, short reads, unexpected ids, retries.
+	DDSM_HEALTH health;
+
+	// round trip statistics and the live timeout of every motor.
+	DDSM_RTT rtt;
+
+	// model of every known motor id, see set_model().
+	DDSM_MODELS models;
+
+	// wheel travel and rover pose from every reply with a position,
+	// configure the wheels with odometry.add_wheel() / set_geometry().
+	DDSM_ODOMETRY odometry;
+
+	// speed / position of every motor at any time, extrapolated from its
+	// last reply: estimator.state(id, micros(), &s) costs no bus time.
+	DDSM_ESTIMATOR estimator;
+
+	// last reply of any motor.
 	int speed_data;  // 115 210
 	int current;     // 210
 	int acceleration_time; // 210
@@ -0,0 +1,83 @@
+#include <string.h>
+
+#include "ddsm_decoder.h"
+
+DDSM_DECODER::DDSM_DECODER()
+    : locked(false),
+      frames(0),
+      dropped(0),
+      resyncs(0),
+      start(0),
+      end(0)
+{
+}
+
+// drop everything buffered, the counters are kept.
+void DDSM_DECODER::reset() {
+  start = 0;
+  end = 0;
+  locked = false;
+}
+
+// move the unread bytes to the front of the window.
+void DDSM_DECODER::compact() {
+  if (start == 0) {
+    return;
+  }
+  if (end > start) {
+    memmove(buf, buf + start, end - start);
+  }
+  end -= start;
+  start = 0;
+}
+
+uint8_t *DDSM_DECODER::tail() {
+  compact();
+  return buf + end;
+}
+
+size_t DDSM_DECODER::space() {
+  compact();
+  return DDSM_DECODER_SIZE - end;
+}
+
+void DDSM_DECODER::commit(size_t length) {
+  end += length;
+  if (end > DDSM_DECODER_SIZE) {
+    end = DDSM_DECODER_SIZE;
+  }
+}
+
+size_t DDSM_DECODER::feed(const uint8_t *data, size_t length) {
+  size_t n = space();
+  if (length < n) {
+    n = length;
+  }
+  memcpy(buf + end, data, n);
+  end += n;
+  return n;
+}
+
+size_t DDSM_DECODER::buffered() {
+  return end - start;
+}
+
+bool DDSM_DECODER::next(uint8_t *frame) {
+  while (end - start >= DDSM_FRAME_LENGTH) {
+    // CRC-8/MAXIM
+    if (crc8_check(buf + start, DDSM_FRAME_LENGTH)) {
+      memcpy(frame, buf + start, DDSM_FRAME_LENGTH);
+      start += DDSM_FRAME_LENGTH;
+      locked = true;
+      frames++;
+      return true;
+    }
+    if (locked) {
+      locked = false;
+      resyncs++;
+    }
+    start++;
+    dropped++;
+  }
+  return false;
+}
@@ -0,0 +1,52 @@
+#ifndef _DDSM_DECODER_H
+#define _DDSM_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_crc.h"
+
+#define DDSM_FRAME_LENGTH 10
+
+// window size, a few frames.
+#define DDSM_DECODER_SIZE 64
+
+// streaming frame decoder for the motor bus.
+// bytes go into a sliding window, a frame is accepted wherever 10 bytes
+// pass the CRC. after a dropped or extra byte the window slides one byte
+// at a time until it locks again, so it recovers within one frame and
+// the rx buffer never has to be flushed.
+class DDSM_DECODER {
+public:
+	DDSM_DECODER();
+
+	void reset();
+
+	// copy bytes in, returns how many fitted.
+	size_t feed(const uint8_t *data, size_t length);
+
+	// zero copy fill: read up to space() bytes into tail(), then commit(n).
+	uint8_t *tail();
+	size_t space();
+	void commit(size_t length);
+
+	// next complete frame, false when the window holds no more.
+	bool next(uint8_t *frame);
+
+	// bytes currently buffered.
+	size_t buffered();
+
+	bool locked;        // last frame passed CRC at the expected boundary
+	uint32_t frames;    // frames decoded
+	uint32_t dropped;   // bytes skipped while searching for a frame
+	uint32_t resyncs;   // times the lock was lost
+
+private:
+	void compact();
+
+	uint8_t buf[DDSM_DECODER_SIZE];
+	size_t start;
+	size_t end;
+};
+
+#endif
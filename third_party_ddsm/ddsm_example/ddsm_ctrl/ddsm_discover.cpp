@@ -0,0 +1,110 @@
+#include <string.h>
+
+#include "ddsm_discover.h"
+
+DDSM_DISCOVER::DDSM_DISCOVER() {
+  begin(1, 0);
+}
+
+void DDSM_DISCOVER::begin(uint8_t first_id, uint8_t last_id, uint32_t rtt_hint_us, uint32_t timeout) {
+  first = first_id < 1 ? 1 : first_id;
+  last = last_id;
+  next_id = first;
+  count = 0;
+  memset(found, 0, sizeof(found));
+  memset(inflight_id, 0, sizeof(inflight_id));
+  inflight_next = 0;
+  rtt_max = 0;
+  sent_at = 0;
+  answered = false;
+  started_at = 0;
+  elapsed_us = 0;
+  gap_us = DDSM_DISCOVER_GAP_US;
+  timeout_us = timeout;
+  if (rtt_hint_us > 0) {
+    follow(rtt_hint_us);
+  }
+}
+
+// the slowest reply must be done before the next probe goes out.
+void DDSM_DISCOVER::follow(uint32_t rtt_us) {
+  if (rtt_us > rtt_max) {
+    rtt_max = rtt_us;
+  }
+  uint32_t gap = rtt_max + DDSM_RTT_MARGIN_US;
+  if (gap < 2 * DDSM_FRAME_US + DDSM_DISCOVER_LISTEN_US) {
+    gap = 2 * DDSM_FRAME_US + DDSM_DISCOVER_LISTEN_US;
+  }
+  if (gap > DDSM_RTT_CEIL_US) {
+    gap = DDSM_RTT_CEIL_US;
+  }
+  gap_us = gap;
+}
+
+// the next probe goes out once the reply of the last one is in, or
+// the slowest reply would be done by now: that id is absent.
+int DDSM_DISCOVER::next_probe(uint32_t now_us, bool rx_busy) {
+  bool probed = next_id > first;
+  if (probed && !answered) {
+    uint32_t since = now_us - sent_at;
+    if (since < gap_us) {
+      return 0;
+    }
+    // a reply is coming in, let it finish (at most one frame).
+    if (rx_busy && since < gap_us + DDSM_FRAME_US) {
+      return 0;
+    }
+  }
+  if (next_id > last) {
+    // the last probe had a full timeout to be answered.
+    uint32_t wait = gap_us + DDSM_FRAME_US > timeout_us ? gap_us + DDSM_FRAME_US : timeout_us;
+    if (probed && !answered && now_us - sent_at < wait) {
+      return 0;
+    }
+    elapsed_us = probed ? now_us - started_at : 0;
+    return -1;
+  }
+  if (!probed) {
+    started_at = now_us;
+  }
+  sent_at = now_us;
+  answered = false;
+  inflight_id[inflight_next] = next_id;
+  inflight_at[inflight_next] = now_us;
+  inflight_next = (inflight_next + 1) % DDSM_DISCOVER_INFLIGHT;
+  return next_id++;
+}
+
+int DDSM_DISCOVER::reply(const uint8_t *f, uint32_t now_us) {
+  uint8_t id = f[0];
+  if (id < first || id > last || id >= next_id || model(id) != 0 || count >= DDSM_DISCOVER_MAX) {
+    return -1;
+  }
+  ddsm_motor &m = found[count];
+  m.id = id;
+  m.model = f[1] == Ddsm210Info::tag ? TYPE_DDSM210 : TYPE_DDSM115;
+  m.rtt_us = 0;
+  for (int i = 0; i < DDSM_DISCOVER_INFLIGHT; i++) {
+    if (inflight_id[i] == id) {
+      m.rtt_us = now_us - inflight_at[i];
+      inflight_id[i] = 0;
+      break;
+    }
+  }
+  if (m.rtt_us > 0) {
+    follow(m.rtt_us);
+  }
+  if (id == next_id - 1) {
+    answered = true;
+  }
+  return count++;
+}
+
+uint8_t DDSM_DISCOVER::model(uint8_t id) const {
+  for (int i = 0; i < count; i++) {
+    if (found[i].id == id) {
+      return found[i].model;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef _DDSM_DISCOVER_H
+#define _DDSM_DISCOVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_driver.h"
+#include "ddsm_rtt.h"
+
+// max motors one scan can find.
+#define DDSM_DISCOVER_MAX 32
+
+// time from a probe to the end of its reply (us) until a reply was
+// timed: the probe itself (~868us), ~630us to the first reply byte and
+// the reply (~868us).
+#define DDSM_DISCOVER_GAP_US 2400
+// the gap never gets shorter than probe and reply plus this.
+#define DDSM_DISCOVER_LISTEN_US 250
+
+// probes whose reply can still be timed.
+#define DDSM_DISCOVER_INFLIGHT 8
+
+// a motor that answered a probe.
+struct ddsm_motor {
+	uint8_t id;
+	uint8_t model;     // TYPE_DDSM115/210, from the reply layout
+	uint32_t rtt_us;   // probe written -> reply decoded, 0: not timed
+};
+
+// short-gap sequential bus scan.
+// an info query (0x74) goes to every id of the range, one at a time: the
+// bus is half duplex, a probe must not go out over a reply. the next one
+// is written as soon as the reply of the one before is in, or had time
+// to be in (the gap), not after a full reply timeout. replies carry their id, so a late one
+// is still matched. the gap follows the slowest reply seen so far.
+// a ddsm210 answers with a 0x74 tagged frame, a ddsm115 with its mode
+// in byte 1, which tells the models apart.
+// no uart in here: the caller writes the probes and feeds the frames,
+// so the library and the example firmware share it.
+class DDSM_DISCOVER {
+public:
+	DDSM_DISCOVER();
+
+	// rtt_hint_us: known round trip of an info query, 0: unknown.
+	// timeout_us: wait for replies after the last probe.
+	void begin(uint8_t first, uint8_t last, uint32_t rtt_hint_us = 0, uint32_t timeout_us = DDSM_RTT_DEFAULT_US);
+
+	// id to probe now (encode and write it right away), 0: not yet,
+	// -1: the scan is over.
+	// rx_busy: part of a frame is buffered, don't talk over it.
+	int next_probe(uint32_t now_us, bool rx_busy);
+
+	// a frame (crc checked) came in at now_us.
+	// returns the index in found[], -1 if it isn't a probe reply.
+	int reply(const uint8_t *f, uint32_t now_us);
+
+	// reply model of a motor already found, 0 if it isn't.
+	uint8_t model(uint8_t id) const;
+
+	ddsm_motor found[DDSM_DISCOVER_MAX];
+	int count;
+
+	uint32_t gap_us;
+	uint32_t started_at;
+	uint32_t elapsed_us;
+
+private:
+	void follow(uint32_t rtt_us);
+
+	uint8_t first;
+	uint8_t last;
+	int next_id;       // last + 1: all probes written
+	uint32_t sent_at;  // last probe
+	bool answered;     // the last probe got its reply
+	uint32_t rtt_max;
+	uint32_t timeout_us;
+
+	uint8_t inflight_id[DDSM_DISCOVER_INFLIGHT];
+	uint32_t inflight_at[DDSM_DISCOVER_INFLIGHT];
+	uint8_t inflight_next;
+};
+
+#endif
@@ -0,0 +1,243 @@
+#ifndef _DDSM_DRIVER_H
+#define _DDSM_DRIVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "ddsm_crc.h"
+#include "ddsm_telemetry.h"
+
+#ifndef TYPE_DDSM115
+#define TYPE_DDSM115  1
+#define TYPE_DDSM210  2
+#endif
+
+// one 10-byte frame at 115200 8N1: 100 bits -> ~868us.
+#define DDSM_FRAME_US 868
+
+// --- frame layouts ---
+// byte offset of every field in a reply frame, -1: not in this frame.
+// tag: value of byte 1 that identifies the frame, -1: not tagged.
+// 16/32 bit fields are big endian.
+
+// ddsm210 feedback:
+// 0  1    2       3       4         5         6        7    8     9
+// ID 0x64 SPEED_H SPEED_L CURRENT_H CURRENT_L ACC_TIME TEMP ERROR CRC8
+struct Ddsm210Fb {
+	static constexpr int tag = 0x64;
+	static constexpr int speed = 2;
+	static constexpr int current = 4;
+	static constexpr int acc_time = 6;
+	static constexpr int temperature = 7;
+	static constexpr int mode = -1;
+	static constexpr int u8 = -1;
+	static constexpr int position = -1;
+	static constexpr int mileage = -1;
+	static constexpr int fault = 8;
+};
+
+// ID 0x74 MILEAGE[4] POS_H POS_L ERROR CRC8
+struct Ddsm210Info {
+	static constexpr int tag = 0x74;
+	static constexpr int speed = -1;
+	static constexpr int current = -1;
+	static constexpr int acc_time = -1;
+	static constexpr int temperature = -1;
+	static constexpr int mode = -1;
+	static constexpr int u8 = -1;
+	static constexpr int position = 6;
+	static constexpr int mileage = 2;
+	static constexpr int fault = 8;
+};
+
+// ddsm115 feedback:
+// 0  1    2        3        4       5       6          7          8     9
+// ID MODE TORQUE_H TORQUE_L SPEED_H SPEED_L POSITION_H POSITION_L ERROR CRC8
+struct Ddsm115Fb {
+	static constexpr int tag = -1;
+	static constexpr int speed = 4;
+	static constexpr int current = 2;
+	static constexpr int acc_time = -1;
+	static constexpr int temperature = -1;
+	static constexpr int mode = 1;
+	static constexpr int u8 = -1;
+	static constexpr int position = 6;
+	static constexpr int mileage = -1;
+	static constexpr int fault = 8;
+};
+
+// ID MODE TORQUE_H TORQUE_L SPEED_H SPEED_L TEMP U8 ERROR CRC8 [info]
+struct Ddsm115Info {
+	static constexpr int tag = -1;
+	static constexpr int speed = 4;
+	static constexpr int current = 2;
+	static constexpr int acc_time = -1;
+	static constexpr int temperature = 6;
+	static constexpr int mode = 1;
+	static constexpr int u8 = 7;
+	static constexpr int position = -1;
+	static constexpr int mileage = -1;
+	static constexpr int fault = 8;
+};
+
+// --- models ---
+// tagged: the reply tells which layout it is, otherwise the layout
+//         follows from the request (info or not).
+// mode_offset: where the 0xA0 mode frame carries the mode,
+// mode_crc: false if byte 9 is the mode instead of a crc.
+// speed_unit: 0.1 rpm per speed loop cmd, speed_max: its limit (cmd).
+struct Ddsm210 {
+	typedef Ddsm210Fb Fb;
+	typedef Ddsm210Info Info;
+	static constexpr uint8_t type = TYPE_DDSM210;
+	static constexpr bool tagged = true;
+	static constexpr int mode_offset = 2;
+	static constexpr bool mode_crc = true;
+	static constexpr int speed_unit = 1;
+	static constexpr int speed_max = 2100;
+};
+
+struct Ddsm115 {
+	typedef Ddsm115Fb Fb;
+	typedef Ddsm115Info Info;
+	static constexpr uint8_t type = TYPE_DDSM115;
+	static constexpr bool tagged = false;
+	static constexpr int mode_offset = 9;
+	static constexpr bool mode_crc = false;
+	static constexpr int speed_unit = 10;
+	static constexpr int speed_max = 200;
+};
+
+// DDSM_FB_* carried by a layout, a compile time constant.
+template <typename L>
+constexpr uint16_t ddsm_layout_fields() {
+	return (L::speed >= 0 ? DDSM_FB_SPEED : 0) |
+	       (L::current >= 0 ? DDSM_FB_CURRENT : 0) |
+	       (L::acc_time >= 0 ? DDSM_FB_ACC_TIME : 0) |
+	       (L::temperature >= 0 ? DDSM_FB_TEMP : 0) |
+	       (L::mode >= 0 ? DDSM_FB_MODE : 0) |
+	       (L::u8 >= 0 ? DDSM_FB_U8 : 0) |
+	       (L::position >= 0 ? DDSM_FB_POS : 0) |
+	       (L::mileage >= 0 ? DDSM_FB_MILEAGE : 0) |
+	       (L::fault >= 0 ? DDSM_FB_FAULT : 0);
+}
+
+static inline uint16_t ddsm_be16(const uint8_t *p) {
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t ddsm_be32(const uint8_t *p) {
+	return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | (uint32_t)p[3];
+}
+
+// ctrl and info requests are the same for both models.
+static inline void ddsm_encode_ctrl(uint8_t *f, uint8_t id, int cmd, uint8_t act) {
+	f[0] = id;
+	f[1] = 0x64;
+	f[2] = (cmd >> 8) & 0xFF;
+	f[3] = cmd & 0xFF;
+	f[4] = 0x00;
+	f[5] = 0x00;
+	f[6] = act;
+	f[7] = 0x00;
+	f[8] = 0x00;
+	f[9] = crc8_frame(f, 9);
+}
+
+static inline void ddsm_encode_info(uint8_t *f, uint8_t id) {
+	f[0] = id;
+	f[1] = 0x74;
+	memset(f + 2, 0, 7);
+	f[9] = crc8_frame(f, 9);
+}
+
+// one motor command of a burst.
+struct ddsm_cmd {
+	uint8_t id;
+	int cmd;
+	uint8_t act;
+};
+
+// id frames, there must be only one ddsm connected for these.
+static inline void ddsm_encode_id_check(uint8_t *f) {
+	f[0] = 0xC8;
+	f[1] = 0x64;
+	memset(f + 2, 0, 7);
+	f[9] = crc8_frame(f, 9); // 0xDE
+}
+
+static inline void ddsm_encode_change_id(uint8_t *f, uint8_t id) {
+	f[0] = 0xAA;
+	f[1] = 0x55;
+	f[2] = 0x53;
+	f[3] = id;
+	memset(f + 4, 0, 5);
+	f[9] = crc8_frame(f, 9);
+}
+
+// frame encoders and the reply decoder of one motor model.
+// everything is static and inline: with the model known at compile time
+// the layout offsets fold into constants and unused fields disappear.
+// f: 10-byte frame buffer owned by the caller.
+template <typename M>
+class DdsmDriver {
+public:
+	static constexpr uint8_t type = M::type;
+
+	static inline void encode_ctrl(uint8_t *f, uint8_t id, int cmd, uint8_t act) {
+		ddsm_encode_ctrl(f, id, cmd, act);
+	}
+
+	static inline void encode_info(uint8_t *f, uint8_t id) {
+		ddsm_encode_info(f, id);
+	}
+
+	static inline void encode_mode(uint8_t *f, uint8_t id, uint8_t mode) {
+		f[0] = id;
+		f[1] = 0xA0;
+		memset(f + 2, 0, 8);
+		f[M::mode_offset] = mode;
+		if (M::mode_crc) {
+			f[9] = crc8_frame(f, 9);
+		}
+	}
+
+	// reply frame (crc already checked) -> fb.
+	// info: the request was an info query.
+	static inline int decode(const uint8_t *f, bool info, ddsm_feedback *fb) {
+		if (M::tagged) {
+			if (f[1] == M::Fb::tag) {
+				unpack<typename M::Fb>(f, fb);
+			} else if (f[1] == M::Info::tag) {
+				unpack<typename M::Info>(f, fb);
+			} else {
+				return -1;
+			}
+		} else if (info) {
+			unpack<typename M::Info>(f, fb);
+		} else {
+			unpack<typename M::Fb>(f, fb);
+		}
+		return 1;
+	}
+
+private:
+	template <typename L>
+	static inline void unpack(const uint8_t *f, ddsm_feedback *fb) {
+		fb->id = f[0];
+		fb->model = M::type;
+		fb->fields = ddsm_layout_fields<L>();
+		if (L::speed >= 0) fb->speed = (int16_t)ddsm_be16(f + L::speed);
+		if (L::current >= 0) fb->current = (int16_t)ddsm_be16(f + L::current);
+		if (L::acc_time >= 0) fb->acc_time = f[L::acc_time];
+		if (L::temperature >= 0) fb->temperature = f[L::temperature];
+		if (L::mode >= 0) fb->mode = f[L::mode];
+		if (L::u8 >= 0) fb->u8 = f[L::u8];
+		if (L::position >= 0) fb->position = ddsm_be16(f + L::position);
+		if (L::mileage >= 0) fb->mileage = (int32_t)ddsm_be32(f + L::mileage);
+		if (L::fault >= 0) fb->fault = f[L::fault];
+	}
+};
+
+#endif
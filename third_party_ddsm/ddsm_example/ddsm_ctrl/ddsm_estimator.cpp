@@ -0,0 +1,155 @@
+#include <math.h>
+#include <string.h>
+
+#include "ddsm_driver.h"
+#include "ddsm_estimator.h"
+
+// position counts per revolution, over seconds per minute.
+#define DDSM_EST_COUNTS_PER_RPM_S (32768.0f / 60.0f)
+
+DDSM_ESTIMATOR::DDSM_ESTIMATOR()
+    : rows(0)
+{
+  memset(row, 0, sizeof(row));
+}
+
+void DDSM_ESTIMATOR::clear() {
+  lock.write_begin();
+  rows = 0;
+  memset(row, 0, sizeof(row));
+  lock.write_end();
+}
+
+int DDSM_ESTIMATOR::find(uint8_t id) const {
+  for (int i = 0; i < rows; i++) {
+    if (row[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint8_t DDSM_ESTIMATOR::row_id(int i) const {
+  return i >= 0 && i < rows ? row[i].id : 0;
+}
+
+// first frame, or the last one is too old to predict from.
+void DDSM_ESTIMATOR::start(ddsm_est_row &r, float speed, uint32_t now_us) {
+  r.speed = speed;
+  r.accel = 0;
+  r.pvv = DDSM_EST_SPEED_SD * DDSM_EST_SPEED_SD;
+  r.pva = 0;
+  r.paa = DDSM_EST_ACCEL_SD * DDSM_EST_ACCEL_SD;
+  r.stamp_us = now_us;
+  r.samples = 1;
+}
+
+int DDSM_ESTIMATOR::update(const ddsm_feedback &fb, uint32_t now_us) {
+  if (!(fb.fields & (DDSM_FB_SPEED | DDSM_FB_POS))) {
+    return -1;
+  }
+  int i = find(fb.id);
+  lock.write_begin();
+  if (i < 0) {
+    if (rows >= DDSM_EST_MAX) {
+      lock.write_end();
+      return -1;
+    }
+    i = rows;
+    memset(&row[i], 0, sizeof(ddsm_est_row));
+    row[i].id = fb.id;
+    rows++;
+  }
+  ddsm_est_row &r = row[i];
+  r.model = fb.model;
+
+  if (fb.fields & DDSM_FB_SPEED) {
+    float z = fb.model == TYPE_DDSM210 ? fb.speed / 10.0f : fb.speed;
+    if (r.samples == 0 || now_us - r.stamp_us > DDSM_EST_STALE_US) {
+      start(r, z, now_us);
+    } else {
+      // predict: constant acceleration, white jerk.
+      float dt = (now_us - r.stamp_us) * 1e-6f;
+      float q = DDSM_EST_JERK * DDSM_EST_JERK;
+      r.speed += r.accel * dt;
+      r.pvv += 2 * dt * r.pva + dt * dt * r.paa + q * dt * dt * dt / 3;
+      r.pva += dt * r.paa + q * dt * dt / 2;
+      r.paa += q * dt;
+
+      // correct with the measured speed.
+      float s = r.pvv + DDSM_EST_SPEED_SD * DDSM_EST_SPEED_SD;
+      float kv = r.pvv / s;
+      float ka = r.pva / s;
+      float y = z - r.speed;
+      r.speed += kv * y;
+      r.accel += ka * y;
+      r.paa -= ka * r.pva;
+      r.pva -= kv * r.pva;
+      r.pvv -= kv * r.pvv;
+      r.stamp_us = now_us;
+      r.samples++;
+    }
+  }
+  if (fb.fields & DDSM_FB_POS) {
+    r.position = fb.position;
+    r.pos_us = now_us;
+    r.has_position = true;
+  }
+  lock.write_end();
+  return i;
+}
+
+int DDSM_ESTIMATOR::state(uint8_t id, uint32_t at_us, ddsm_state *out) const {
+  // seqlock reader side: copy the row, retry while a write overlaps.
+  ddsm_est_row r;
+  uint32_t s;
+  do {
+    s = lock.read_begin();
+    int i = find(id);
+    if (i < 0) {
+      memset(&r, 0, sizeof(r));
+    } else {
+      memcpy(&r, &row[i], sizeof(r));
+    }
+  } while (lock.read_retry(s));
+  if (r.samples == 0 && !r.has_position) {
+    return -1;
+  }
+
+  float q = DDSM_EST_JERK * DDSM_EST_JERK;
+  float t = (int32_t)(at_us - r.stamp_us) * 1e-6f;
+  float at = fabsf(t);
+  float pvv = r.pvv + 2 * t * r.pva + t * t * r.paa + q * at * at * at / 3;
+
+  out->id = r.id;
+  out->model = r.model;
+  out->has_position = r.has_position;
+  out->speed = r.speed + r.accel * t;
+  out->accel = r.accel;
+  out->speed_sd = sqrtf(pvv > 0 ? pvv : 0);
+  out->position = 0;
+  out->position_sd = 0;
+  out->samples = r.samples;
+
+  uint32_t last = r.stamp_us;
+  if (r.has_position) {
+    // travel from the position frame to at_us with the speed curve
+    // v(x) = speed + accel * x around stamp_us.
+    float tp = (int32_t)(at_us - r.pos_us) * 1e-6f;
+    float t0 = (int32_t)(r.pos_us - r.stamp_us) * 1e-6f;
+    float cv = tp;
+    float ca = (t * t - t0 * t0) / 2;
+    float pos = r.position + (r.speed * cv + r.accel * ca) * DDSM_EST_COUNTS_PER_RPM_S;
+    pos = fmodf(pos, 32768.0f);
+    out->position = pos < 0 ? pos + 32768.0f : pos;
+    float atp = fabsf(tp);
+    float var = cv * cv * r.pvv + 2 * cv * ca * r.pva + ca * ca * r.paa + q * atp * atp * atp * atp * atp / 20;
+    out->position_sd = sqrtf(var > 0 ? var : 0) * DDSM_EST_COUNTS_PER_RPM_S;
+    if ((int32_t)(r.pos_us - last) > 0 || r.samples == 0) {
+      last = r.pos_us;
+    }
+  }
+  int32_t age = (int32_t)(at_us - last);
+  out->age_us = age > 0 ? age : 0;
+  return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef _DDSM_ESTIMATOR_H
+#define _DDSM_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_telemetry.h"
+#include "ddsm_seqlock.h"
+
+// max motors.
+#define DDSM_EST_MAX DDSM_TELEMETRY_MAX
+
+// speed measurement noise (rpm, 1 sigma), about the ddsm115 resolution.
+#define DDSM_EST_SPEED_SD 0.5f
+// how fast the acceleration may change (rpm/s^2, 1 sigma over 1 s).
+// larger follows steps sooner, smaller smooths more.
+#define DDSM_EST_JERK 5000.0f
+// acceleration uncertainty of a fresh filter (rpm/s, 1 sigma).
+#define DDSM_EST_ACCEL_SD 1000.0f
+// no frame for this long: start over from the next one.
+#define DDSM_EST_STALE_US 500000
+
+// estimate of one motor at some time.
+struct ddsm_state {
+	uint8_t id;
+	uint8_t model;
+	bool has_position;   // a position was seen (ddsm115 ctrl, ddsm210 info)
+	float speed;         // rpm
+	float accel;         // rpm/s
+	float position;      // 0 ~ 32768 -> 0 ~ 360°, wrapped
+	float speed_sd;      // rpm, 1 sigma of speed
+	float position_sd;   // counts, 1 sigma of position
+	uint32_t age_us;     // since the last frame of the motor
+	uint32_t samples;    // frames since the filter (re)started
+};
+
+// one motor, writer side.
+struct ddsm_est_row {
+	uint8_t id;
+	uint8_t model;
+	bool has_position;
+	float speed;         // rpm at stamp_us
+	float accel;         // rpm/s
+	float pvv, pva, paa; // covariance of (speed, accel)
+	float position;      // counts at pos_us
+	uint32_t stamp_us;
+	uint32_t pos_us;
+	uint32_t samples;
+};
+
+// state estimator next to the telemetry.
+// every frame with a speed runs a two state (speed, acceleration)
+// kalman filter, constant acceleration between frames. state() then
+// answers "where is the motor at time t" from the last frame without a
+// bus round trip: speed and acceleration extrapolated, the position
+// carried forward with the speed, and how far that can be trusted
+// (age and 1 sigma of speed and position).
+// written by the bus side only, state() can be read from any task
+// (DDSM_SEQLOCK).
+class DDSM_ESTIMATOR {
+public:
+	DDSM_ESTIMATOR();
+
+	void clear();
+
+	// apply a decoded frame, writer side only.
+	// returns the row, -1 if it has no speed or the table is full.
+	int update(const ddsm_feedback &fb, uint32_t now_us);
+
+	// estimate of motor id at at_us (micros(), past or future).
+	// returns 0, -1 if the motor was never seen.
+	int state(uint8_t id, uint32_t at_us, ddsm_state *out) const;
+
+	// motor of row i, 0 if there is none. rows never move once added.
+	uint8_t row_id(int i) const;
+
+	uint8_t rows;
+
+private:
+	int find(uint8_t id) const;
+	void start(ddsm_est_row &r, float speed, uint32_t now_us);
+
+	DDSM_SEQLOCK lock;
+	ddsm_est_row row[DDSM_EST_MAX];
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include <string.h>
+
+#include "ddsm_fleet.h"
+
+DDSM_FLEET::DDSM_FLEET()
+    : buses(0),
+      routes(0)
+{
+}
+
+// seqlock reader side: retry while a write overlaps the copy.
+// returns the number of routes in out.
+uint8_t DDSM_FLEET::copy_routes(ddsm_fleet_route *out) const {
+  uint32_t s;
+  uint8_t n;
+  do {
+    s = lock.read_begin();
+    n = routes;
+    memcpy(out, route, sizeof(route));
+  } while (lock.read_retry(s));
+  return n;
+}
+
+int DDSM_FLEET::add_bus(DDSM_CTRL *dc, uint16_t rate) {
+  if (buses >= DDSM_FLEET_MAX_BUSES) {
+    return -1;
+  }
+  bus[buses].begin(dc, rate);
+  return buses++;
+}
+
+int DDSM_FLEET::find(uint8_t id) const {
+  for (int i = 0; i < routes; i++) {
+    if (route[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int DDSM_FLEET::add_motor(uint8_t id, uint8_t b) {
+  if (b >= buses) {
+    return -1;
+  }
+  int r = find(id);
+  if (r >= 0 && route[r].bus != b) {
+    remove_motor(id);
+    r = -1;
+  }
+  if (r < 0 && routes >= DDSM_FLEET_MAX_MOTORS) {
+    return -1;
+  }
+  int i = bus[b].add_motor(id);
+  if (i < 0) {
+    return -1;
+  }
+  if (r < 0) {
+    lock.write_begin();
+    route[routes].id = id;
+    route[routes].bus = b;
+    routes++;
+    lock.write_end();
+  }
+  return i;
+}
+
+int DDSM_FLEET::remove_motor(uint8_t id) {
+  int r = find(id);
+  if (r < 0) {
+    return -1;
+  }
+  bus[route[r].bus].remove_motor(id);
+  lock.write_begin();
+  for (int j = r; j < routes - 1; j++) {
+    route[j] = route[j + 1];
+  }
+  routes--;
+  lock.write_end();
+  return r;
+}
+
+int DDSM_FLEET::bus_of(uint8_t id) const {
+  int r = find(id);
+  return r < 0 ? -1 : route[r].bus;
+}
+
+DDSM_CTRL *DDSM_FLEET::ctrl_of(uint8_t id) {
+  int b = bus_of(id);
+  return b < 0 ? nullptr : bus[b].ctrl;
+}
+
+void DDSM_FLEET::set_rate(uint16_t rate) {
+  for (int b = 0; b < buses; b++) {
+    bus[b].set_rate(rate);
+  }
+}
+
+void DDSM_FLEET::set_info_every(uint16_t cycles) {
+  for (int b = 0; b < buses; b++) {
+    bus[b].set_info_every(cycles);
+  }
+}
+
+// bus->ctrl tells which bus called.
+void DDSM_FLEET::set_callback(ddsm_bus_callback cb, void *arg) {
+  for (int b = 0; b < buses; b++) {
+    bus[b].set_callback(cb, arg);
+  }
+}
+
+int DDSM_FLEET::set_cmd(uint8_t id, int cmd, uint8_t act) {
+  int b = bus_of(id);
+  if (b < 0) {
+    return -1;
+  }
+  return bus[b].set_cmd(id, cmd, act);
+}
+
+// one step of every scheduler: a bus whose reply came in starts its
+// next frame while the others are still waiting for theirs.
+void DDSM_FLEET::run() {
+  for (int b = 0; b < buses; b++) {
+    bus[b].run();
+  }
+}
+
+// copy row i of src to row j of dst.
+static void copy_row(ddsm_telemetry_data *dst, int j, const ddsm_telemetry_data &src, int i) {
+  dst->id[j] = src.id[i];
+  dst->model[j] = src.model[i];
+  dst->speed[j] = src.speed[i];
+  dst->current[j] = src.current[i];
+  dst->acc_time[j] = src.acc_time[i];
+  dst->temperature[j] = src.temperature[i];
+  dst->mode[j] = src.mode[i];
+  dst->u8[j] = src.u8[i];
+  dst->fault[j] = src.fault[i];
+  dst->position[j] = src.position[i];
+  dst->mileage[j] = src.mileage[i];
+  dst->stamp_us[j] = src.stamp_us[i];
+  dst->updates[j] = src.updates[i];
+}
+
+// only the motors routed to a bus are taken from its table, the routes
+// are copied first.
+void DDSM_FLEET::snapshot(ddsm_telemetry_data *out) const {
+  ddsm_fleet_route routed[DDSM_FLEET_MAX_MOTORS];
+  uint8_t n = copy_routes(routed);
+  ddsm_telemetry_data one;
+  out->count = 0;
+  for (int b = 0; b < buses; b++) {
+    if (!bus[b].ctrl) {
+      continue;
+    }
+    bus[b].ctrl->telemetry.snapshot(&one);
+    for (int i = 0; i < one.count && out->count < DDSM_TELEMETRY_MAX; i++) {
+      for (int r = 0; r < n; r++) {
+        if (routed[r].id == one.id[i]) {
+          if (routed[r].bus == b) {
+            copy_row(out, out->count++, one, i);
+          }
+          break;
+        }
+      }
+    }
+  }
+}
+
+float DDSM_FLEET::achieved_rate(uint8_t id) {
+  int b = bus_of(id);
+  return b < 0 ? 0 : bus[b].achieved_rate(id);
+}
+
+float DDSM_FLEET::cycle_rate() {
+  float slowest = 0;
+  for (int b = 0; b < buses; b++) {
+    float hz = bus[b].cycle_rate();
+    if (b == 0 || hz < slowest) {
+      slowest = hz;
+    }
+  }
+  return slowest;
+}
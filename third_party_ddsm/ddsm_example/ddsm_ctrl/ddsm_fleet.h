@@ -0,0 +1,77 @@
+#ifndef _DDSM_FLEET_H
+#define _DDSM_FLEET_H
+
+#include "ddsm_bus.h"
+#include "ddsm_seqlock.h"
+
+// max buses, the esp32 has three uarts (uart0 is usually the console).
+#define DDSM_FLEET_MAX_BUSES 3
+
+// max motors over all buses, the merged telemetry holds one table.
+#define DDSM_FLEET_MAX_MOTORS DDSM_TELEMETRY_MAX
+
+struct ddsm_fleet_route {
+	uint8_t id;
+	uint8_t bus;
+};
+
+// motors spread over several uarts.
+// every bus is a DDSM_CTRL (its own uart) with its own DDSM_BUS
+// scheduler, a routing table sends each motor id to its bus.
+// run() drives all of them without blocking, so every bus keeps its own
+// transaction in flight and the buses work at the same time: two buses
+// poll twice the motors at the same rate.
+// the telemetry of all buses is read as one table with snapshot().
+// add_bus() is setup only. motors are added and removed by the task that
+// runs the buses, the routing table is guarded by a DDSM_SEQLOCK so
+// snapshot() can read it from any other task.
+class DDSM_FLEET {
+public:
+	DDSM_FLEET();
+
+	// rate: target polling rate of every motor of this bus (Hz).
+	// returns the bus index, -1 if all are taken.
+	int add_bus(DDSM_CTRL *dc, uint16_t rate);
+
+	// returns the motor index on its bus, -1 if the bus doesn't exist
+	// or a table is full. an id already routed moves to the new bus.
+	int add_motor(uint8_t id, uint8_t bus);
+	int remove_motor(uint8_t id);
+
+	// bus of a motor, -1 if it isn't routed.
+	int bus_of(uint8_t id) const;
+	DDSM_CTRL *ctrl_of(uint8_t id);
+
+	// same as DDSM_BUS, for every bus.
+	void set_rate(uint16_t rate);
+	void set_info_every(uint16_t cycles);
+	void set_callback(ddsm_bus_callback cb, void *arg);
+
+	// setpoint of a motor, on its bus.
+	int set_cmd(uint8_t id, int cmd, uint8_t act);
+
+	// call as often as possible from loop(), never blocks.
+	void run();
+
+	// rows of every bus in one table. each bus and the routing table are
+	// copied consistently, safe from any task/core.
+	void snapshot(ddsm_telemetry_data *out) const;
+
+	float achieved_rate(uint8_t id);
+	// slowest bus.
+	float cycle_rate();
+
+	DDSM_BUS bus[DDSM_FLEET_MAX_BUSES];
+	uint8_t buses;
+
+	ddsm_fleet_route route[DDSM_FLEET_MAX_MOTORS];
+	uint8_t routes;
+
+private:
+	int find(uint8_t id) const;
+	uint8_t copy_routes(ddsm_fleet_route *out) const;
+
+	DDSM_SEQLOCK lock;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#include <string.h>
+
+#include "ddsm_health.h"
+
+DDSM_HEALTH::DDSM_HEALTH() {
+  clear();
+}
+
+void DDSM_HEALTH::clear() {
+  rows = 0;
+  memset(row, 0, sizeof(row));
+  memset(&total, 0, sizeof(total));
+}
+
+int DDSM_HEALTH::find(uint8_t id) const {
+  for (int i = 0; i < rows; i++) {
+    if (row[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void DDSM_HEALTH::count(uint8_t id, int kind) {
+  if (kind < 0 || kind >= DDSM_HEALTH_KINDS) {
+    return;
+  }
+  total.count[kind]++;
+  if (id == 0) {
+    return;
+  }
+  int i = find(id);
+  if (i < 0) {
+    // rows start with a request, so a garbled id that happened to pass
+    // the CRC can't take a row.
+    if (kind != DDSM_HEALTH_REQUEST || rows >= DDSM_HEALTH_MAX) {
+      return;
+    }
+    i = rows;
+    row[i].id = id;
+    rows++;
+  }
+  row[i].count[kind]++;
+}
+
+uint32_t DDSM_HEALTH::get(uint8_t id, int kind) const {
+  int i = find(id);
+  if (i < 0 || kind < 0 || kind >= DDSM_HEALTH_KINDS) {
+    return 0;
+  }
+  return row[i].count[kind];
+}
@@ -0,0 +1,52 @@
+#ifndef _DDSM_HEALTH_H
+#define _DDSM_HEALTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// max motors in the table.
+#define DDSM_HEALTH_MAX 8
+
+// counter kinds.
+#define DDSM_HEALTH_REQUEST    0 // frame sent to the motor, retries included
+#define DDSM_HEALTH_REPLY      1 // good reply
+#define DDSM_HEALTH_TIMEOUT    2 // nothing came back
+#define DDSM_HEALTH_CRC_ERR    3 // bytes came back but failed the CRC
+#define DDSM_HEALTH_SHORT      4 // less than a frame came back
+#define DDSM_HEALTH_UNEXPECTED 5 // frame from this id while nobody waited for it
+#define DDSM_HEALTH_RETRY      6 // request sent again after a failure
+#define DDSM_HEALTH_KINDS      7
+
+// link counters of one motor.
+struct ddsm_health_row {
+	uint8_t id;
+	uint32_t count[DDSM_HEALTH_KINDS]; // indexed by DDSM_HEALTH_*
+};
+
+// per-motor bus health.
+// one bad motor (cable, connector) shows up as errors on its own row,
+// a saturated bus as timeouts spread over all rows.
+// written by the bus side only, counters are single 32-bit words so
+// other tasks can read them without a lock.
+class DDSM_HEALTH {
+public:
+	DDSM_HEALTH();
+
+	void clear();
+
+	// row of a motor, -1 if unknown.
+	int find(uint8_t id) const;
+
+	// kind: DDSM_HEALTH_*. id 0 (id check, any motor), ids never sent a
+	// request and motors that don't fit the table only count in the total.
+	void count(uint8_t id, int kind);
+
+	// counter of a motor, 0 if unknown.
+	uint32_t get(uint8_t id, int kind) const;
+
+	uint8_t rows;
+	ddsm_health_row row[DDSM_HEALTH_MAX];
+	ddsm_health_row total; // whole bus, id 0
+};
+
+#endif
@@ -0,0 +1,47 @@
+#include <string.h>
+
+#include "ddsm_models.h"
+
+DDSM_MODELS::DDSM_MODELS() {
+  clear();
+}
+
+void DDSM_MODELS::clear() {
+  rows = 0;
+  memset(row, 0, sizeof(row));
+}
+
+int DDSM_MODELS::set(uint8_t id, uint8_t model) {
+  for (int i = 0; i < rows; i++) {
+    if (row[i].id != id) {
+      continue;
+    }
+    if (model == 0) {
+      rows--;
+      memmove(row + i, row + i + 1, (rows - i) * sizeof(ddsm_model_row));
+      return 0;
+    }
+    row[i].model = model;
+    return model;
+  }
+  if (model == 0) {
+    return 0;
+  }
+  if (rows >= DDSM_MODELS_MAX) {
+    return -1;
+  }
+  row[rows].id = id;
+  row[rows].model = model;
+  rows++;
+  return model;
+}
+
+// looked up for every frame, a linear scan over a few rows.
+uint8_t DDSM_MODELS::get(uint8_t id) const {
+  for (int i = 0; i < rows; i++) {
+    if (row[i].id == id) {
+      return row[i].model;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,36 @@
+#ifndef _DDSM_MODELS_H
+#define _DDSM_MODELS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_driver.h"
+
+// max motors in the table.
+#define DDSM_MODELS_MAX 32
+
+struct ddsm_model_row {
+	uint8_t id;
+	uint8_t model; // TYPE_DDSM115/210
+};
+
+// model of every motor id, so ddsm115s and ddsm210s can share a bus.
+// set by command or filled by DDSM_DISCOVER, ids not in the table fall
+// back to the default type of the caller.
+class DDSM_MODELS {
+public:
+	DDSM_MODELS();
+
+	void clear();
+
+	// model 0 removes the id. returns the model, -1 when the table is full.
+	int set(uint8_t id, uint8_t model);
+
+	// 0 if unknown.
+	uint8_t get(uint8_t id) const;
+
+	uint8_t rows;
+	ddsm_model_row row[DDSM_MODELS_MAX];
+};
+
+#endif
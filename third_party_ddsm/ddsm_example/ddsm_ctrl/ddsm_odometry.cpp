@@ -0,0 +1,199 @@
+#include <math.h>
+#include <string.h>
+
+#include "ddsm_driver.h"
+#include "ddsm_odometry.h"
+
+DDSM_ODOMETRY::DDSM_ODOMETRY()
+    : radius(DDSM_ODOM_RADIUS),
+      track(DDSM_ODOM_TRACK)
+{
+  set_geometry(DDSM_ODOM_RADIUS, DDSM_ODOM_TRACK);
+  clear();
+}
+
+void DDSM_ODOMETRY::clear() {
+  wheels = 0;
+  memset(wheel, 0, sizeof(wheel));
+  side_count[DDSM_ODOM_LEFT] = 0;
+  side_count[DDSM_ODOM_RIGHT] = 0;
+  pending[DDSM_ODOM_LEFT] = 0;
+  pending[DDSM_ODOM_RIGHT] = 0;
+  moved = 0;
+  reset_pose(0, 0, 0);
+}
+
+void DDSM_ODOMETRY::set_geometry(float wheel_radius, float track_width) {
+  radius = wheel_radius;
+  track = track_width;
+  half_track_mm = (int32_t)lroundf(track * 500);
+  // 1 mm/s = 600 / (2 pi r mm) 0.1 rpm.
+  rpm_q16 = radius > 0 ? (int32_t)lroundf(65536 * 0.6f / (2 * (float)M_PI * radius)) : 0;
+}
+
+int DDSM_ODOMETRY::find(uint8_t id) const {
+  for (int i = 0; i < wheels; i++) {
+    if (wheel[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int DDSM_ODOMETRY::add_wheel(uint8_t id, uint8_t side, int8_t dir) {
+  side = side == DDSM_ODOM_RIGHT ? DDSM_ODOM_RIGHT : DDSM_ODOM_LEFT;
+  int i = find(id);
+  if (i < 0) {
+    if (wheels >= DDSM_ODOM_WHEELS) {
+      return -1;
+    }
+    i = wheels++;
+    memset(&wheel[i], 0, sizeof(ddsm_wheel));
+    wheel[i].id = id;
+  } else {
+    side_count[wheel[i].side]--;
+  }
+  wheel[i].side = side;
+  wheel[i].dir = dir < 0 ? -1 : 1;
+  side_count[side]++;
+  return i;
+}
+
+void DDSM_ODOMETRY::reset_pose(float x, float y, float heading) {
+  lock.write_begin();
+  state.x = x;
+  state.y = y;
+  state.heading = heading;
+  state.distance = 0;
+  state.stamp_us = 0;
+  state.updates = 0;
+  lock.write_end();
+}
+
+int DDSM_ODOMETRY::update(const ddsm_feedback &fb, uint32_t now_us) {
+  int i = find(fb.id);
+  if (i < 0) {
+    return -1;
+  }
+  ddsm_wheel &w = wheel[i];
+  int32_t speed = w.speed;
+  if (fb.fields & DDSM_FB_SPEED) {
+    w.speed = fb.model == TYPE_DDSM210 ? fb.speed : fb.speed * 10;
+  }
+  if (!(fb.fields & DDSM_FB_POS)) {
+    return -1;
+  }
+
+  int64_t dticks = 0;
+  if (fb.fields & DDSM_FB_MILEAGE) {
+    // whole turns + position: absolute, nothing to unwrap.
+    int64_t abs = (int64_t)fb.mileage * DDSM_ODOM_TICKS + fb.position;
+    dticks = abs - w.abs;
+    w.abs = abs;
+  } else {
+    int32_t delta = (int32_t)fb.position - w.pos;
+    // expected ticks from the mean speed (0.1 rpm) since the last frame,
+    // the wrap count that lands closest to it wins.
+    int64_t expect = (int64_t)(speed + w.speed) * (now_us - w.stamp_us) * DDSM_ODOM_TICKS / (2 * 600 * 1000000LL);
+    int64_t diff = expect - delta;
+    int64_t wraps = (diff >= 0 ? diff + DDSM_ODOM_TICKS / 2 : diff - DDSM_ODOM_TICKS / 2 + 1) / DDSM_ODOM_TICKS;
+    dticks = delta + wraps * DDSM_ODOM_TICKS;
+  }
+  w.pos = fb.position;
+  w.stamp_us = now_us;
+  if (!w.valid) {
+    w.valid = true;
+    return i;
+  }
+  // one pose step per round over the wheels, so the sides move
+  // together and the order of the replies doesn't bend the path.
+  if (moved & (1u << i)) {
+    step(now_us);
+  }
+  w.ticks += dticks;
+  pending[w.side] += (float)(dticks * w.dir) * (2 * (float)M_PI * radius / DDSM_ODOM_TICKS) / side_count[w.side];
+  moved |= 1u << i;
+  if (moved == (1u << wheels) - 1) {
+    step(now_us);
+  }
+  return i;
+}
+
+// the center moves by the mean of the sides,
+// their difference turns the rover.
+void DDSM_ODOMETRY::step(uint32_t now_us) {
+  float ds = (pending[DDSM_ODOM_LEFT] + pending[DDSM_ODOM_RIGHT]) / 2;
+  float dth = (pending[DDSM_ODOM_RIGHT] - pending[DDSM_ODOM_LEFT]) / track;
+  pending[DDSM_ODOM_LEFT] = 0;
+  pending[DDSM_ODOM_RIGHT] = 0;
+  moved = 0;
+
+  lock.write_begin();
+  float mid = state.heading + dth / 2;
+  state.x += ds * cosf(mid);
+  state.y += ds * sinf(mid);
+  state.heading += dth;
+  state.distance += ds;
+  state.stamp_us = now_us;
+  state.updates++;
+  lock.write_end();
+}
+
+// seqlock reader side: retry while a write overlaps the copy.
+void DDSM_ODOMETRY::pose(ddsm_pose *out) const {
+  uint32_t s;
+  do {
+    s = lock.read_begin();
+    memcpy(out, &state, sizeof(state));
+  } while (lock.read_retry(s));
+}
+
+float DDSM_ODOMETRY::wheel_distance(int index) const {
+  if (index < 0 || index >= wheels) {
+    return 0;
+  }
+  const ddsm_wheel &w = wheel[index];
+  return (float)(w.ticks * w.dir) * (2 * (float)M_PI * radius / DDSM_ODOM_TICKS);
+}
+
+int DDSM_ODOMETRY::drive(int32_t v_mm_s, int32_t w_mrad_s, const DDSM_MODELS &models, uint8_t fallback,
+                         ddsm_cmd *out, int max) const {
+  int32_t turn = (int32_t)((int64_t)w_mrad_s * half_track_mm / 1000);
+  int64_t rpm[DDSM_ODOM_WHEELS];
+  int unit[DDSM_ODOM_WHEELS];
+  // the wheel furthest over its limit: |rpm| / limit is largest.
+  int64_t over = 1;
+  int64_t over_limit = 1;
+  int n = 0;
+  for (int i = 0; i < wheels && n < max; i++, n++) {
+    const ddsm_wheel &w = wheel[i];
+    uint8_t model = models.get(w.id);
+    if (model == 0) {
+      model = fallback;
+    }
+    int64_t limit;
+    if (model == TYPE_DDSM210) {
+      unit[n] = Ddsm210::speed_unit;
+      limit = Ddsm210::speed_max * Ddsm210::speed_unit;
+    } else {
+      unit[n] = Ddsm115::speed_unit;
+      limit = Ddsm115::speed_max * Ddsm115::speed_unit;
+    }
+    int64_t mm_s = w.side == DDSM_ODOM_LEFT ? v_mm_s - turn : v_mm_s + turn;
+    rpm[n] = (mm_s * rpm_q16 * w.dir + 32768) >> 16;
+    int64_t mag = rpm[n] < 0 ? -rpm[n] : rpm[n];
+    if (mag * over_limit > over * limit) {
+      over = mag;
+      over_limit = limit;
+    }
+    out[n].id = w.id;
+    out[n].act = 0;
+  }
+  for (int i = 0; i < n; i++) {
+    // scaled towards 0, no wheel ends up over its limit.
+    int64_t r = over > over_limit ? rpm[i] * over_limit / over : rpm[i];
+    int64_t half = unit[i] / 2;
+    out[i].cmd = (int)((r + (r < 0 ? -half : half)) / unit[i]);
+  }
+  return n;
+}
@@ -0,0 +1,116 @@
+#ifndef _DDSM_ODOMETRY_H
+#define _DDSM_ODOMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_driver.h"
+#include "ddsm_models.h"
+#include "ddsm_seqlock.h"
+#include "ddsm_telemetry.h"
+
+// max wheels.
+#define DDSM_ODOM_WHEELS 8
+
+// position counts per revolution.
+#define DDSM_ODOM_TICKS 32768
+
+// wheel sides.
+#define DDSM_ODOM_LEFT  0
+#define DDSM_ODOM_RIGHT 1
+
+// defaults (m).
+#define DDSM_ODOM_RADIUS 0.05f
+#define DDSM_ODOM_TRACK  0.30f
+
+struct ddsm_wheel {
+	uint8_t id;
+	uint8_t side;        // DDSM_ODOM_LEFT / RIGHT
+	int8_t dir;          // 1, -1: mounted mirrored, forward is backwards
+	bool valid;          // a position was seen
+	uint16_t pos;        // last position, 0 ~ 32767
+	int64_t abs;         // last mileage * 32768 + position (210 info)
+	int32_t speed;       // last speed, 0.1 rpm
+	uint32_t stamp_us;
+	int64_t ticks;       // unwrapped travel since clear(), motor direction
+};
+
+// rover pose, dead reckoning from the wheels.
+struct ddsm_pose {
+	float x;             // m
+	float y;             // m
+	float heading;       // rad, counter clockwise, not wrapped
+	float distance;      // m travelled by the center, signed
+	uint32_t stamp_us;   // micros() of the last wheel update
+	uint32_t updates;
+};
+
+// wheel odometry next to the bus.
+// every feedback frame with a position moves its wheel: the ddsm115 sends
+// one in each ctrl reply, the ddsm210 only in info (0x74) replies, together
+// with the whole turns (mileage) so nothing has to be unwrapped there.
+// a ddsm115 position wraps every turn, the step since the last frame is
+// taken as the one closest to speed * time, so even a wheel that turns
+// more than half a turn between two frames is followed.
+// positions are counted in 64-bit ticks, 32768 per turn.
+// wheel travel goes into a differential / skid steer pose: all wheels of
+// one side are averaged, heading from the difference of the sides. the
+// pose takes a step once every wheel reported (or one reports twice).
+// written by the bus side only, pose() can be read from any task
+// (DDSM_SEQLOCK).
+class DDSM_ODOMETRY {
+public:
+	DDSM_ODOMETRY();
+
+	// forget wheels and pose.
+	void clear();
+
+	// wheel radius and distance between the left and right wheels (m).
+	void set_geometry(float wheel_radius, float track_width);
+
+	// returns the wheel index, -1 if the table is full.
+	int add_wheel(uint8_t id, uint8_t side, int8_t dir);
+	int find(uint8_t id) const;
+
+	// pose back to (x, y, heading), wheel travel kept.
+	void reset_pose(float x, float y, float heading);
+
+	// apply a decoded frame, writer side only.
+	// returns the wheel index, -1 if it isn't a wheel or has no position.
+	int update(const ddsm_feedback &fb, uint32_t now_us);
+
+	// consistent copy of the pose, safe from any task/core.
+	void pose(ddsm_pose *out) const;
+
+	// wheel travel (m), forward positive.
+	float wheel_distance(int index) const;
+
+	// the other way round: speed setpoints (motor direction) of every
+	// wheel for the rover velocity, v mm/s forward, w mrad/s counter
+	// clockwise. integer only, the factors come from set_geometry().
+	// cmd is in the units of the wheel's model (models, fallback for the
+	// ids not in it): ddsm115 rpm, ddsm210 0.1 rpm. a wheel over its
+	// model's limit slows every wheel down by the same factor, the rover
+	// keeps its curve. act left to the caller.
+	// returns the wheels written, at most max.
+	int drive(int32_t v_mm_s, int32_t w_mrad_s, const DDSM_MODELS &models, uint8_t fallback,
+	          ddsm_cmd *out, int max) const;
+
+	uint8_t wheels;
+	ddsm_wheel wheel[DDSM_ODOM_WHEELS];
+	float radius;
+	float track;
+	int32_t half_track_mm;
+	int32_t rpm_q16;     // 0.1 rpm per mm/s of wheel speed, << 16
+
+private:
+	void step(uint32_t now_us);
+
+	DDSM_SEQLOCK lock;
+	ddsm_pose state;
+	uint8_t side_count[2];
+	float pending[2];    // side travel (m) since the last step
+	uint32_t moved;      // wheels in pending
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include <string.h>
+
+#include "ddsm_record.h"
+
+int ddsm_decode_record(const uint8_t *in, ddsm_record *rec) {
+  uint8_t frame[10];
+  frame[0] = in[2];
+  memcpy(frame + 1, in + 7, 8);
+  rec->time_us = ddsm_be32(in + 3);
+  rec->info = (in[1] & DDSM_REC_INFO) != 0;
+  memset(&rec->fb, 0, sizeof(rec->fb));
+  uint8_t model = in[1] & ~DDSM_REC_INFO;
+  if (model == TYPE_DDSM210) {
+    return DdsmDriver<Ddsm210>::decode(frame, rec->info, &rec->fb);
+  }
+  if (model == TYPE_DDSM115) {
+    return DdsmDriver<Ddsm115>::decode(frame, rec->info, &rec->fb);
+  }
+  return -1;
+}
+
+DDSM_RECORD_DECODER::DDSM_RECORD_DECODER()
+    : records(0),
+      lines(0),
+      dropped(0),
+      start(0),
+      end(0),
+      text_len(0)
+{
+  text[0] = 0;
+}
+
+// drop everything buffered, the counters are kept.
+void DDSM_RECORD_DECODER::reset() {
+  start = 0;
+  end = 0;
+  text_len = 0;
+  text[0] = 0;
+}
+
+// move the unread bytes to the front of the window.
+void DDSM_RECORD_DECODER::compact() {
+  if (start == 0) {
+    return;
+  }
+  if (end > start) {
+    memmove(buf, buf + start, end - start);
+  }
+  end -= start;
+  start = 0;
+}
+
+size_t DDSM_RECORD_DECODER::feed(const uint8_t *data, size_t length) {
+  compact();
+  size_t n = DDSM_REC_WINDOW - end;
+  if (length < n) {
+    n = length;
+  }
+  memcpy(buf + end, data, n);
+  end += n;
+  return n;
+}
+
+const char *DDSM_RECORD_DECODER::line() {
+  return text;
+}
+
+int DDSM_RECORD_DECODER::next(ddsm_record *rec) {
+  while (start < end) {
+    uint8_t b = buf[start];
+    if (b == DDSM_REC_SYNC) {
+      if (end - start < DDSM_REC_LENGTH) {
+        // wait for the rest of it.
+        return DDSM_REC_NONE;
+      }
+      if (crc8_frame(buf + start, DDSM_REC_LENGTH - 1) == buf[start + DDSM_REC_LENGTH - 1] &&
+          ddsm_decode_record(buf + start, rec) > 0) {
+        start += DDSM_REC_LENGTH;
+        records++;
+        return DDSM_REC_RECORD;
+      }
+      // a stray SYNC, e.g. inside a utf-8 string: it's text.
+      dropped++;
+    }
+    start++;
+    if (b == '\n') {
+      if (text_len > 0 && text[text_len - 1] == '\r') {
+        text_len--;
+      }
+      text[text_len] = 0;
+      text_len = 0;
+      lines++;
+      return DDSM_REC_LINE;
+    }
+    if (text_len < DDSM_REC_LINE_MAX - 1) {
+      text[text_len++] = (char)b;
+    }
+  }
+  return DDSM_REC_NONE;
+}
@@ -0,0 +1,94 @@
+#ifndef _DDSM_RECORD_H
+#define _DDSM_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "ddsm_driver.h"
+
+// compact binary telemetry: one fixed 16-byte record per motor reply
+// instead of a ~100 byte JSON line, on the same link as the JSON lines.
+// 0    1    2  3..6       7..14              15
+// SYNC KIND ID TIME_US[4] FRAME[1..8]        CRC8
+// KIND: model (TYPE_DDSM115/210) | DDSM_REC_INFO for an info reply.
+// TIME_US: micros() when the reply was decoded, big endian.
+// FRAME: bytes 1..8 of the motor's reply as it came off the bus, so
+//        DdsmDriver<>::decode reads the fields (layouts in ddsm_driver.h).
+// CRC8: CRC-8/MAXIM of bytes 0..14.
+// the JSON lines are plain ASCII, SYNC is not, so a reader tells the
+// two apart byte by byte and resyncs on the CRC like DDSM_DECODER.
+
+#define DDSM_REC_SYNC 0xA5
+#define DDSM_REC_LENGTH 16
+#define DDSM_REC_INFO 0x10
+
+// window size of the decoder, a few records.
+#define DDSM_REC_WINDOW 64
+// longest text line kept by the decoder, longer ones are cut.
+#define DDSM_REC_LINE_MAX 256
+
+// what DDSM_RECORD_DECODER::next() found.
+#define DDSM_REC_NONE 0
+#define DDSM_REC_RECORD 1
+#define DDSM_REC_LINE 2
+
+struct ddsm_record {
+	uint32_t time_us;
+	bool info;
+	ddsm_feedback fb;
+};
+
+// record of a reply frame (10 bytes, crc checked) into out[DDSM_REC_LENGTH].
+static inline size_t ddsm_encode_record(uint8_t *out, const uint8_t *frame, uint8_t model, bool info, uint32_t time_us) {
+	out[0] = DDSM_REC_SYNC;
+	out[1] = model | (info ? DDSM_REC_INFO : 0);
+	out[2] = frame[0];
+	out[3] = (time_us >> 24) & 0xFF;
+	out[4] = (time_us >> 16) & 0xFF;
+	out[5] = (time_us >> 8) & 0xFF;
+	out[6] = time_us & 0xFF;
+	for (int i = 0; i < 8; i++) {
+		out[7 + i] = frame[1 + i];
+	}
+	out[15] = crc8_frame(out, 15);
+	return DDSM_REC_LENGTH;
+}
+
+// record -> rec. returns 1, -1 if the model is unknown or the frame
+// doesn't match it.
+int ddsm_decode_record(const uint8_t *in, ddsm_record *rec);
+
+// host side reader of the bridge's usb link: splits the byte stream into
+// records and the JSON (text) lines between them.
+class DDSM_RECORD_DECODER {
+public:
+	DDSM_RECORD_DECODER();
+
+	void reset();
+
+	// copy bytes in, returns how many fitted.
+	size_t feed(const uint8_t *data, size_t length);
+
+	// DDSM_REC_RECORD: rec is filled,
+	// DDSM_REC_LINE: line() holds a text line without the line end,
+	// DDSM_REC_NONE: nothing complete yet.
+	int next(ddsm_record *rec);
+
+	// last text line, nul terminated.
+	const char *line();
+
+	uint32_t records;   // records decoded
+	uint32_t lines;     // text lines
+	uint32_t dropped;   // SYNC bytes that didn't start a good record
+
+private:
+	void compact();
+
+	uint8_t buf[DDSM_REC_WINDOW];
+	size_t start;
+	size_t end;
+	char text[DDSM_REC_LINE_MAX];
+	size_t text_len;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#include <string.h>
+
+#include "ddsm_rtt.h"
+
+DDSM_RTT::DDSM_RTT()
+    : floor_us(DDSM_RTT_FLOOR_US),
+      ceil_us(DDSM_RTT_CEIL_US)
+{
+  clear();
+}
+
+void DDSM_RTT::clear() {
+  rows = 0;
+  memset(row, 0, sizeof(row));
+  memset(bus, 0, sizeof(bus));
+}
+
+// floor == ceil: fixed timeout.
+void DDSM_RTT::set_limits(uint32_t floor, uint32_t ceil) {
+  if (ceil < floor) {
+    ceil = floor;
+  }
+  floor_us = floor;
+  ceil_us = ceil;
+}
+
+int DDSM_RTT::find(uint8_t id) const {
+  for (int i = 0; i < rows; i++) {
+    if (row[i].id == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// ewma / deviation as in TCP (RFC 6298), the p99 as a stochastic
+// quantile estimate: it moves up by 0.99 step when a sample is above it
+// and down by 0.01 step otherwise, so it settles where 1% are above.
+void DDSM_RTT::update(ddsm_rtt_stats &s, uint32_t rtt_us) {
+  float x = rtt_us;
+  if (s.samples == 0) {
+    s.ewma_us = x;
+    s.dev_us = x / 2;
+    s.p99_us = x;
+  } else {
+    float err = x - s.ewma_us;
+    s.ewma_us += err / 8;
+    s.dev_us += ((err < 0 ? -err : err) - s.dev_us) / 4;
+    float step = s.ewma_us / 16;
+    if (step < 1) {
+      step = 1;
+    }
+    if (x > s.p99_us) {
+      s.p99_us += step * 0.99f;
+    } else {
+      s.p99_us -= step * 0.01f;
+    }
+  }
+  if (rtt_us > s.max_us) {
+    s.max_us = rtt_us;
+  }
+  s.samples++;
+  s.timeout_us = derive(s);
+}
+
+uint32_t DDSM_RTT::derive(const ddsm_rtt_stats &s) const {
+  float t = s.ewma_us + 4 * s.dev_us;
+  if (s.p99_us > t) {
+    t = s.p99_us;
+  }
+  t += DDSM_RTT_MARGIN_US;
+  if (t < floor_us) {
+    return floor_us;
+  }
+  if (t > ceil_us) {
+    return ceil_us;
+  }
+  return (uint32_t)t;
+}
+
+void DDSM_RTT::sample(uint8_t id, int kind, uint32_t rtt_us) {
+  if (kind < 0 || kind >= DDSM_RTT_KINDS) {
+    return;
+  }
+  update(bus[kind], rtt_us);
+  int i = find(id);
+  if (i < 0) {
+    if (rows >= DDSM_RTT_MAX) {
+      return;
+    }
+    i = rows;
+    row[i].id = id;
+    rows++;
+  }
+  row[i].lost = false;
+  update(row[i].kind[kind], rtt_us);
+}
+
+void DDSM_RTT::lost(uint8_t id, int kind, uint32_t sent_us) {
+  int i = find(id);
+  if (i < 0 || kind < 0 || kind >= DDSM_RTT_KINDS) {
+    return;
+  }
+  row[i].lost = true;
+  row[i].lost_kind = kind;
+  row[i].lost_at = sent_us;
+}
+
+bool DDSM_RTT::late(uint8_t id, uint32_t now_us) {
+  int i = find(id);
+  if (i < 0 || !row[i].lost) {
+    return false;
+  }
+  row[i].lost = false;
+  uint32_t rtt = now_us - row[i].lost_at;
+  // much later than any timeout: not an answer to that request.
+  if (rtt > 2 * ceil_us) {
+    return false;
+  }
+  sample(id, row[i].lost_kind, rtt);
+  return true;
+}
+
+uint32_t DDSM_RTT::timeout(uint8_t id, int kind) const {
+  if (kind < 0 || kind >= DDSM_RTT_KINDS) {
+    return DDSM_RTT_DEFAULT_US;
+  }
+  int i = find(id);
+  if (i >= 0 && row[i].kind[kind].samples >= DDSM_RTT_MIN_SAMPLES) {
+    return derive(row[i].kind[kind]);
+  }
+  if (bus[kind].samples >= DDSM_RTT_MIN_SAMPLES) {
+    return derive(bus[kind]);
+  }
+  if (DDSM_RTT_DEFAULT_US < floor_us) {
+    return floor_us;
+  }
+  if (DDSM_RTT_DEFAULT_US > ceil_us) {
+    return ceil_us;
+  }
+  return DDSM_RTT_DEFAULT_US;
+}
+
+const ddsm_rtt_stats *DDSM_RTT::stats(uint8_t id, int kind) const {
+  int i = find(id);
+  if (i < 0 || kind < 0 || kind >= DDSM_RTT_KINDS) {
+    return nullptr;
+  }
+  return &row[i].kind[kind];
+}
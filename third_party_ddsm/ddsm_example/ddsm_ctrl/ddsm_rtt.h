@@ -0,0 +1,88 @@
+#ifndef _DDSM_RTT_H
+#define _DDSM_RTT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// max motors in the table.
+#define DDSM_RTT_MAX 8
+
+// request kinds, timed separately.
+#define DDSM_RTT_CTRL  0 // 0x64
+#define DDSM_RTT_INFO  1 // 0x74
+#define DDSM_RTT_KINDS 2
+
+// timeout limits (us). a request and its reply take 2 * DDSM_FRAME_US
+// (~1.74ms) on the wire at 115200, the floor adds DDSM_RTT_MARGIN_US
+// for the motor's turnaround: no timeout shorter than a possible reply.
+#define DDSM_RTT_FLOOR_US   2000
+#define DDSM_RTT_CEIL_US    10000
+#define DDSM_RTT_MARGIN_US  250
+// default timeout until enough replies were timed.
+#define DDSM_RTT_DEFAULT_US 4000
+#define DDSM_RTT_MIN_SAMPLES 8
+
+// round trip statistics of one motor and request kind.
+struct ddsm_rtt_stats {
+	uint32_t samples;
+	float ewma_us;        // smoothed round trip, gain 1/8
+	float dev_us;         // smoothed mean deviation, gain 1/4
+	float p99_us;         // running 99th percentile estimate
+	uint32_t max_us;
+	uint32_t timeout_us;  // timeout derived from the above
+};
+
+struct ddsm_rtt_row {
+	uint8_t id;
+	ddsm_rtt_stats kind[DDSM_RTT_KINDS];
+	// last timed out request: a reply that turns up later is still
+	// a valid (long) sample, otherwise the timeout could never grow.
+	bool lost;
+	uint8_t lost_kind;
+	uint32_t lost_at;     // micros() when it was sent
+};
+
+// reply timeouts that follow the measured round trip time.
+// timeout = max(ewma + 4 * dev, p99) + margin, clamped to floor..ceil.
+// a motor with too few samples uses the bus-wide statistics, so an
+// unplugged wheel costs about one normal round trip per poll,
+// not the default timeout.
+class DDSM_RTT {
+public:
+	DDSM_RTT();
+
+	void clear();
+	void set_limits(uint32_t floor_us, uint32_t ceil_us);
+
+	// row of a motor, -1 if unknown.
+	int find(uint8_t id) const;
+
+	// time from writing a request to decoding its reply.
+	void sample(uint8_t id, int kind, uint32_t rtt_us);
+
+	// a request sent at sent_us got no reply in time.
+	void lost(uint8_t id, int kind, uint32_t sent_us);
+
+	// a frame from id arrived while nobody waited for it. if it answers
+	// the last lost request it is sampled, returns true then.
+	bool late(uint8_t id, uint32_t now_us);
+
+	// timeout for the next request of this kind to this motor.
+	uint32_t timeout(uint8_t id, int kind) const;
+
+	// live statistics, nullptr if unknown.
+	const ddsm_rtt_stats *stats(uint8_t id, int kind) const;
+
+	uint8_t rows;
+	ddsm_rtt_row row[DDSM_RTT_MAX];
+	ddsm_rtt_stats bus[DDSM_RTT_KINDS]; // all motors
+
+private:
+	void update(ddsm_rtt_stats &s, uint32_t rtt_us);
+	uint32_t derive(const ddsm_rtt_stats &s) const;
+
+	uint32_t floor_us;
+	uint32_t ceil_us;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef _DDSM_SEQLOCK_H
+#define _DDSM_SEQLOCK_H
+
+#include <stdint.h>
+
+// sequence counter for one writer and lock-free readers (seqlock).
+// odd while the writer changes the guarded data. a reader copies the
+// data between read_begin() and read_retry() and copies again until
+// no write overlapped:
+//
+//   uint32_t s;
+//   do {
+//     s = lock.read_begin();
+//     memcpy(&copy, &data, sizeof(data));
+//   } while (lock.read_retry(s));
+class DDSM_SEQLOCK {
+public:
+	DDSM_SEQLOCK() : seq(0) {}
+
+	// writer side, around every change of the data.
+	void write_begin() {
+		__atomic_store_n(&seq, seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+	}
+
+	void write_end() {
+		__atomic_store_n(&seq, seq + 1, __ATOMIC_RELEASE);
+	}
+
+	// reader side: waits for an even value, the copy starts after it.
+	uint32_t read_begin() const {
+		uint32_t s;
+		do {
+			s = __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+		} while (s & 1);
+		return s;
+	}
+
+	// true if a write overlapped the copy since read_begin().
+	bool read_retry(uint32_t s) const {
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		return __atomic_load_n(&seq, __ATOMIC_RELAXED) != s;
+	}
+
+	// bumped twice per write.
+	uint32_t sequence() const {
+		return __atomic_load_n(&seq, __ATOMIC_ACQUIRE);
+	}
+
+private:
+	uint32_t seq;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <string.h>
+
+#include "ddsm_telemetry.h"
+
+DDSM_TELEMETRY::DDSM_TELEMETRY() {
+  memset(&data, 0, sizeof(data));
+}
+
+void DDSM_TELEMETRY::clear() {
+  lock.write_begin();
+  memset(&data, 0, sizeof(data));
+  lock.write_end();
+}
+
+uint32_t DDSM_TELEMETRY::sequence() const {
+  return lock.sequence();
+}
+
+int DDSM_TELEMETRY::find(uint8_t id) const {
+  for (int i = 0; i < data.count; i++) {
+    if (data.id[i] == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int DDSM_TELEMETRY::add(uint8_t id, uint8_t model) {
+  int i = find(id);
+  if (i >= 0) {
+    return i;
+  }
+  if (data.count >= DDSM_TELEMETRY_MAX) {
+    return -1;
+  }
+  lock.write_begin();
+  i = data.count;
+  data.id[i] = id;
+  data.model[i] = model;
+  data.updates[i] = 0;
+  data.count++;
+  lock.write_end();
+  return i;
+}
+
+int DDSM_TELEMETRY::update(const ddsm_feedback &fb, uint32_t now_us) {
+  int i = add(fb.id, fb.model);
+  if (i < 0) {
+    return -1;
+  }
+
+  lock.write_begin();
+  data.model[i] = fb.model;
+  if (fb.fields & DDSM_FB_SPEED) {
+    data.speed[i] = fb.speed;
+  }
+  if (fb.fields & DDSM_FB_CURRENT) {
+    data.current[i] = fb.current;
+  }
+  if (fb.fields & DDSM_FB_ACC_TIME) {
+    data.acc_time[i] = fb.acc_time;
+  }
+  if (fb.fields & DDSM_FB_TEMP) {
+    data.temperature[i] = fb.temperature;
+  }
+  if (fb.fields & DDSM_FB_MODE) {
+    data.mode[i] = fb.mode;
+  }
+  if (fb.fields & DDSM_FB_U8) {
+    data.u8[i] = fb.u8;
+  }
+  if (fb.fields & DDSM_FB_POS) {
+    data.position[i] = fb.position;
+  }
+  if (fb.fields & DDSM_FB_MILEAGE) {
+    data.mileage[i] = fb.mileage;
+  }
+  if (fb.fields & DDSM_FB_FAULT) {
+    data.fault[i] = fb.fault;
+  }
+  data.stamp_us[i] = now_us;
+  data.updates[i]++;
+  lock.write_end();
+  return i;
+}
+
+// seqlock reader side: retry while a write overlaps the copy.
+void DDSM_TELEMETRY::snapshot(ddsm_telemetry_data *out) const {
+  uint32_t s;
+  do {
+    s = lock.read_begin();
+    memcpy(out, &data, sizeof(data));
+  } while (lock.read_retry(s));
+}
@@ -0,0 +1,88 @@
+#ifndef _DDSM_TELEMETRY_H
+#define _DDSM_TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ddsm_seqlock.h"
+
+// max motors in the table.
+#define DDSM_TELEMETRY_MAX 8
+
+// fields carried by a feedback frame.
+#define DDSM_FB_SPEED    0x0001
+#define DDSM_FB_CURRENT  0x0002 // 210 current / 115 torque current
+#define DDSM_FB_ACC_TIME 0x0004
+#define DDSM_FB_TEMP     0x0008
+#define DDSM_FB_MODE     0x0010
+#define DDSM_FB_U8       0x0020
+#define DDSM_FB_POS      0x0040
+#define DDSM_FB_MILEAGE  0x0080
+#define DDSM_FB_FAULT    0x0100
+
+// one decoded feedback frame.
+struct ddsm_feedback {
+	uint8_t id;
+	uint8_t model;       // TYPE_DDSM115 / TYPE_DDSM210
+	uint16_t fields;     // DDSM_FB_* present in this frame
+	int16_t speed;       // 115: rpm, 210: 0.1 rpm
+	int16_t current;     // -32767 ~ 32767 -> -8 ~ 8 A
+	uint8_t acc_time;
+	uint8_t temperature;
+	uint8_t mode;
+	uint8_t u8;
+	uint16_t position;   // 0 ~ 32767 -> 0 ~ 360°
+	int32_t mileage;
+	uint8_t fault;
+};
+
+// the table, one array per field (struct-of-arrays),
+// row i holds the last known state of motor id[i].
+struct ddsm_telemetry_data {
+	uint8_t count;
+	uint8_t id[DDSM_TELEMETRY_MAX];
+	uint8_t model[DDSM_TELEMETRY_MAX];
+	int16_t speed[DDSM_TELEMETRY_MAX];
+	int16_t current[DDSM_TELEMETRY_MAX];
+	uint8_t acc_time[DDSM_TELEMETRY_MAX];
+	uint8_t temperature[DDSM_TELEMETRY_MAX];
+	uint8_t mode[DDSM_TELEMETRY_MAX];
+	uint8_t u8[DDSM_TELEMETRY_MAX];
+	uint8_t fault[DDSM_TELEMETRY_MAX];
+	uint16_t position[DDSM_TELEMETRY_MAX];
+	int32_t mileage[DDSM_TELEMETRY_MAX];
+	uint32_t stamp_us[DDSM_TELEMETRY_MAX]; // micros() of the last update
+	uint32_t updates[DDSM_TELEMETRY_MAX];  // frames applied to the row
+};
+
+// per-motor telemetry with lock-free snapshots.
+// one writer (the bus side) updates rows, any number of readers on other
+// tasks/cores copy the whole table with snapshot(). a sequence counter
+// (DDSM_SEQLOCK) is odd while a row is being written, readers retry
+// until they copied the table between two equal, even values.
+class DDSM_TELEMETRY {
+public:
+	DDSM_TELEMETRY();
+
+	void clear();
+
+	// row of a motor, -1 if unknown.
+	int find(uint8_t id) const;
+
+	// row of a motor, added if needed (-1 when the table is full).
+	int add(uint8_t id, uint8_t model);
+
+	// apply a decoded frame, writer side only.
+	int update(const ddsm_feedback &fb, uint32_t now_us);
+
+	// consistent copy of the whole table, safe from any task/core.
+	void snapshot(ddsm_telemetry_data *out) const;
+
+	// bumped twice per update.
+	uint32_t sequence() const;
+
+private:
+	DDSM_SEQLOCK lock;
+	ddsm_telemetry_data data;
+};
+
+#endif
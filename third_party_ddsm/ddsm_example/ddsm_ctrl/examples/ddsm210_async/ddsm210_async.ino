@@ -0,0 +1,55 @@
+/*
+non-blocking speed ctrl of four DDSM210.
+begin_ctrl() queues the frame and returns right away,
+poll() drives the bus and calls on_reply() for every reply.
+*/
+
+#include <ddsm_ctrl.h>
+
+DDSM_CTRL dc;
+
+// device settings.
+#define DDSM_RX 18
+#define DDSM_TX 19
+
+unsigned long last_cycle = 0;
+int speed_cmd = 500;
+
+void on_reply(DDSM_CTRL *ctrl, int handle, int status, void *arg) {
+	int id = (int)(intptr_t)arg;
+	if (status != DDSM_TXN_DONE) {
+		Serial.print("no reply from ");
+		Serial.println(id);
+		return;
+	}
+	Serial.print(id);
+	Serial.print(" speed: ");
+	Serial.println(ctrl->speed_data);
+}
+
+void setup() {
+	Serial.begin(115200);
+
+	// ddsm init.
+	Serial1.begin(DDSM_BAUDRATE, SERIAL_8N1, DDSM_RX, DDSM_TX);
+	dc.pSerial = &Serial1;
+
+	// config the type of ddsm. 
+	dc.set_ddsm_type(210);
+
+	// clear ddsm serial buffer.
+	dc.clear_ddsm_buffer();
+}
+
+void loop() {
+	// queue a ctrl frame for every wheel each 20ms.
+	if (millis() - last_cycle >= 20 && dc.txn_pending() == 0) {
+		last_cycle = millis();
+		for (int id = 1; id <= 4; id++) {
+			dc.begin_ctrl(id, speed_cmd, 3, on_reply, (void *)(intptr_t)id);
+		}
+	}
+
+	// never blocks, the loop is free for other work.
+	dc.poll();
+}
@@ -0,0 +1,62 @@
+/*
+poll four DDSM210 at 200Hz with the bus scheduler.
+every motor gets its ctrl frame once per cycle,
+info queries are spread over the cycles.
+*/
+
+#include <ddsm_bus.h>
+
+DDSM_CTRL dc;
+DDSM_BUS bus;
+
+// device settings.
+#define DDSM_RX 18
+#define DDSM_TX 19
+
+unsigned long last_print = 0;
+ddsm_telemetry_data snap;
+
+void setup() {
+	Serial.begin(115200);
+
+	// ddsm init.
+	Serial1.begin(DDSM_BAUDRATE, SERIAL_8N1, DDSM_RX, DDSM_TX);
+	dc.pSerial = &Serial1;
+
+	// config the type of ddsm. 
+	dc.set_ddsm_type(210);
+
+	// clear ddsm serial buffer.
+	dc.clear_ddsm_buffer();
+
+	// args: begin(DDSM_CTRL, RATE_HZ)
+	bus.begin(&dc, 200);
+	for (int id = 1; id <= 4; id++) {
+		bus.add_motor(id);
+		// args: set_cmd(DDSM_ID, CMD, ACC_TIME)
+		bus.set_cmd(id, 300, 3); // speed: 30.0 rpm
+	}
+	// one info query per motor every 50 cycles.
+	bus.set_info_every(50);
+}
+
+void loop() {
+	bus.run();
+
+	if (millis() - last_print >= 1000) {
+		last_print = millis();
+		// every wheel in one consistent read.
+		dc.telemetry.snapshot(&snap);
+		for (int i = 0; i < snap.count; i++) {
+			Serial.print(snap.id[i]);
+			Serial.print(" speed: ");
+			Serial.print(snap.speed[i]);
+			Serial.print(" temp: ");
+			Serial.print(snap.temperature[i]);
+			Serial.print(" rate: ");
+			Serial.println(bus.achieved_rate(snap.id[i]));
+		}
+		Serial.print("cycle rate: ");
+		Serial.println(bus.cycle_rate());
+	}
+}
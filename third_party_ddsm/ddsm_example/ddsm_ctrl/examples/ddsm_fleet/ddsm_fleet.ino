@@ -0,0 +1,71 @@
+/*
+four DDSM210 on two uarts, two per bus.
+each bus has its own scheduler and both work at the same time,
+so every wheel is polled about twice as often as on one bus.
+*/
+
+#include <ddsm_fleet.h>
+
+DDSM_CTRL left_dc;
+DDSM_CTRL right_dc;
+DDSM_FLEET fleet;
+
+// device settings.
+#define DDSM_RX 18
+#define DDSM_TX 19
+#define DDSM2_RX 16
+#define DDSM2_TX 17
+
+unsigned long last_print = 0;
+ddsm_telemetry_data snap;
+
+void setup() {
+	Serial.begin(115200);
+
+	// ddsm init, one uart per bus.
+	Serial1.begin(DDSM_BAUDRATE, SERIAL_8N1, DDSM_RX, DDSM_TX);
+	left_dc.pSerial = &Serial1;
+	left_dc.set_ddsm_type(210);
+	left_dc.clear_ddsm_buffer();
+
+	Serial2.begin(DDSM_BAUDRATE, SERIAL_8N1, DDSM2_RX, DDSM2_TX);
+	right_dc.pSerial = &Serial2;
+	right_dc.set_ddsm_type(210);
+	right_dc.clear_ddsm_buffer();
+
+	// args: add_bus(DDSM_CTRL, RATE_HZ)
+	int left = fleet.add_bus(&left_dc, 200);
+	int right = fleet.add_bus(&right_dc, 200);
+
+	// args: add_motor(DDSM_ID, BUS)
+	fleet.add_motor(1, left);
+	fleet.add_motor(3, left);
+	fleet.add_motor(2, right);
+	fleet.add_motor(4, right);
+	for (int id = 1; id <= 4; id++) {
+		// args: set_cmd(DDSM_ID, CMD, ACC_TIME)
+		fleet.set_cmd(id, 300, 3); // speed: 30.0 rpm
+	}
+	fleet.set_info_every(50);
+}
+
+void loop() {
+	fleet.run();
+
+	if (millis() - last_print >= 1000) {
+		last_print = millis();
+		// the wheels of both buses in one table.
+		fleet.snapshot(&snap);
+		for (int i = 0; i < snap.count; i++) {
+			Serial.print(snap.id[i]);
+			Serial.print(" bus: ");
+			Serial.print(fleet.bus_of(snap.id[i]));
+			Serial.print(" speed: ");
+			Serial.print(snap.speed[i]);
+			Serial.print(" rate: ");
+			Serial.println(fleet.achieved_rate(snap.id[i]));
+		}
+		Serial.print("cycle rate: ");
+		Serial.println(fleet.cycle_rate());
+	}
+}
@@ -0,0 +1,112 @@
+/*
+host-side microbenchmark for the ddsm CRC-8/MAXIM.
+compares the old bitwise crc8_update loop with the table in ddsm_crc.h
+and prints frames per second for frame encode/check and batch verify.
+
+build & run (from this folder):
+  g++ -O2 -std=c++11 -I../.. crc_bench.cpp -o crc_bench && ./crc_bench
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ddsm_crc.h"
+
+static const size_t packet_length = 10;
+
+// the loop that used to be copy-pasted into every call site.
+static uint8_t crc8_update_bitwise(uint8_t crc, uint8_t data) {
+  uint8_t i;
+  crc = crc ^ data;
+  for (i = 0; i < 8; ++i) {
+    if (crc & 0x01) {
+      crc = (crc >> 1) ^ 0x8c;
+    } else {
+      crc >>= 1;
+    }
+  }
+  return crc;
+}
+
+static bool check_bitwise(const uint8_t *data) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < packet_length - 1; ++i) {
+    crc = crc8_update_bitwise(crc, data[i]);
+  }
+  return crc == data[9];
+}
+
+static bool check_table(const uint8_t *data) {
+  return crc8_check(data, packet_length);
+}
+
+typedef bool (*check_fn)(const uint8_t *);
+
+// keeps the optimizer from dropping the work.
+static volatile size_t sink;
+
+static double run(const char *name, check_fn fn, const std::vector<uint8_t> &frames,
+                  size_t count, int rounds) {
+  auto t0 = std::chrono::steady_clock::now();
+  size_t ok = 0;
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t n = 0; n < count; ++n) {
+      ok += fn(&frames[n * packet_length]) ? 1 : 0;
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  sink = ok;
+  double sec = std::chrono::duration<double>(t1 - t0).count();
+  double fps = (double)count * rounds / sec;
+  printf("%-22s %12.0f frames/s  (%6.2f ns/frame)\n", name, fps, 1e9 / fps);
+  return fps;
+}
+
+int main(int argc, char **argv) {
+  size_t count = 4096;
+  int rounds = argc > 1 ? atoi(argv[1]) : 500;
+
+  // self-check: both versions agree on every byte value.
+  for (int c = 0; c < 256; ++c) {
+    for (int d = 0; d < 256; ++d) {
+      if (crc8_update_bitwise((uint8_t)c, (uint8_t)d) != crc8_update((uint8_t)c, (uint8_t)d)) {
+        printf("table mismatch at crc=%d data=%d\n", c, d);
+        return 1;
+      }
+    }
+  }
+
+  // random frames with a valid crc, every 8th one corrupted.
+  std::vector<uint8_t> frames(count * packet_length);
+  srand(1);
+  for (size_t n = 0; n < count; ++n) {
+    uint8_t *f = &frames[n * packet_length];
+    for (size_t i = 0; i < packet_length - 1; ++i) {
+      f[i] = (uint8_t)rand();
+    }
+    f[9] = crc8_frame(f, packet_length - 1);
+    if (n % 8 == 7) {
+      f[9] ^= 0x01;
+    }
+  }
+
+  double old_fps = run("bitwise check", check_bitwise, frames, count, rounds);
+  double new_fps = run("table check", check_table, frames, count, rounds);
+
+  auto t0 = std::chrono::steady_clock::now();
+  size_t ok = 0;
+  for (int r = 0; r < rounds; ++r) {
+    ok += crc8_check_frames(frames.data(), count, packet_length);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  sink = ok;
+  double sec = std::chrono::duration<double>(t1 - t0).count();
+  double batch_fps = (double)count * rounds / sec;
+  printf("%-22s %12.0f frames/s  (%6.2f ns/frame)\n", "table batch verify",
+         batch_fps, 1e9 / batch_fps);
+
+  printf("speedup: %.2fx (single), %.2fx (batch)\n", new_fps / old_fps, batch_fps / old_fps);
+  return 0;
+}
@@ -0,0 +1,374 @@
+/*
+host-side benchmark of the ddsm_ctrl library.
+runs against MockSerial with motors that answer instantly, so the numbers
+are the CPU cost of the driver itself (encode, CRC, decode, bookkeeping)
+per call / per transaction, not bus time.
+
+build & run:
+  cmake -S . -B build && cmake --build build && ./build/ddsm_bench [ITERS]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ddsm_bincmd.h"
+#include "ddsm_bus.h"
+#include "ddsm_record.h"
+#include "mock_serial.h"
+
+// --- instant motors behind the mock ---
+
+struct bench_bus {
+  uint8_t model[256]; // 0: no motor with this id
+};
+
+static void put_reply(MockSerial *s, uint8_t *r) {
+  r[9] = crc8_frame(r, 9);
+  s->inject(r, 10);
+}
+
+static void motor_responder(MockSerial *s, const uint8_t *data, size_t length, void *arg) {
+  bench_bus *bus = (bench_bus *)arg;
+  for (size_t off = 0; off + 10 <= length; off += 10) {
+    const uint8_t *f = data + off;
+    uint8_t r[10] = {0};
+    if (f[0] == 0xC8 && f[1] == 0x64) {
+      r[0] = 1;
+      r[1] = 0x64;
+      put_reply(s, r);
+      continue;
+    }
+    if (f[0] == 0xAA && f[1] == 0x55 && f[2] == 0x53) {
+      continue;
+    }
+    uint8_t model = bus->model[f[0]];
+    if (!model || f[1] == 0xA0) {
+      continue;
+    }
+    r[0] = f[0];
+    if (model == TYPE_DDSM210) {
+      r[1] = f[1];
+      if (f[1] == 0x64) {
+        r[2] = f[2];
+        r[3] = f[3];
+        r[6] = f[6];
+        r[7] = 31;
+      } else {
+        r[5] = 0x10;
+        r[6] = 0x12;
+        r[7] = 0x34;
+      }
+    } else {
+      r[1] = 2;
+      r[4] = f[2];
+      r[5] = f[3];
+      r[6] = 0x12;
+      r[7] = 0x34;
+    }
+    put_reply(s, r);
+  }
+}
+
+// --- timing ---
+
+static double cpu_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double wall_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile int sink;
+
+// per: operations done by one call of fn, the result is per operation.
+template <typename F>
+static void bench(const char *name, long iters, F fn, int per = 1) {
+  double c0 = cpu_ns();
+  double w0 = wall_ns();
+  for (long i = 0; i < iters; i++) {
+    fn(i);
+  }
+  double cpu = (cpu_ns() - c0) / iters / per;
+  double wall = (wall_ns() - w0) / iters / per;
+  printf("%-34s %10.1f ns cpu %10.1f ns wall %12.0f /s\n", name, cpu, wall, 1e9 / wall);
+}
+
+int main(int argc, char **argv) {
+  long iters = argc > 1 ? atol(argv[1]) : 200000;
+
+  bench_bus motors;
+  memset(&motors, 0, sizeof(motors));
+  for (int id = 1; id <= 4; id++) {
+    motors.model[id] = TYPE_DDSM210;
+  }
+  motors.model[5] = TYPE_DDSM115;
+
+  MockSerial serial;
+  serial.keep_tx(false);
+  serial.set_responder(motor_responder, &motors);
+
+  DDSM_CTRL dc;
+  dc.pSerial = &serial;
+  dc.set_ddsm_type(210);
+
+  // manual clock: every micros() moves time by 1us, so timeouts and
+  // the holds of ddsm_change_id expire without waiting in real time.
+  ddsm_host_clock_manual(1);
+
+  printf("--- crc / decode ---\n");
+  uint8_t frame[10] = {1, 0x64, 0x01, 0xF4, 0x00, 0x05, 0x03, 0x1F, 0x00, 0x00};
+  frame[9] = crc8_frame(frame, 9);
+  bench("crc8_frame (9 bytes)", iters * 10, [&](long i) {
+    frame[2] = (uint8_t)i;
+    sink = crc8_frame(frame, 9);
+  });
+
+  static uint8_t stream[64 * 10];
+  for (int n = 0; n < 64; n++) {
+    memcpy(stream + n * 10, frame, 10);
+  }
+  DDSM_DECODER dec;
+  uint8_t out[10];
+  bench("decoder feed+next (per frame)", iters / 8, [&](long) {
+    size_t off = 0;
+    while (off < sizeof(stream)) {
+      off += dec.feed(stream + off, sizeof(stream) - off);
+      while (dec.next(out)) {
+        sink = out[0];
+      }
+    }
+  }, 64);
+
+  // one stray byte before every frame.
+  static uint8_t noisy[64 * 11];
+  for (int n = 0; n < 64; n++) {
+    noisy[n * 11] = 0x55;
+    memcpy(noisy + n * 11 + 1, frame, 10);
+  }
+  bench("decoder resync (per frame)", iters / 8, [&](long) {
+    size_t off = 0;
+    while (off < sizeof(noisy)) {
+      off += dec.feed(noisy + off, sizeof(noisy) - off);
+      while (dec.next(out)) {
+        sink = out[0];
+      }
+    }
+  }, 64);
+
+  ddsm_feedback fb;
+  memset(&fb, 0, sizeof(fb));
+  bench("DdsmDriver<Ddsm210>::encode_ctrl", iters * 10, [&](long i) {
+    DdsmDriver<Ddsm210>::encode_ctrl(out, 1, (int)i, 3);
+    sink = out[9];
+  });
+  bench("DdsmDriver<Ddsm210>::decode", iters * 10, [&](long i) {
+    frame[1] = (i & 1) ? 0x64 : 0x74;
+    sink = DdsmDriver<Ddsm210>::decode(frame, false, &fb) + fb.fault;
+  });
+  bench("DdsmDriver<Ddsm115>::decode", iters * 10, [&](long i) {
+    sink = DdsmDriver<Ddsm115>::decode(frame, i & 1, &fb) + fb.fault;
+  });
+  frame[1] = 0x64;
+
+  DDSM_TELEMETRY tel;
+  fb.model = TYPE_DDSM210;
+  fb.fields = DDSM_FB_SPEED | DDSM_FB_CURRENT | DDSM_FB_TEMP | DDSM_FB_FAULT;
+  bench("telemetry.update", iters, [&](long i) {
+    fb.id = 1 + (i & 3);
+    fb.speed = (int16_t)i;
+    tel.update(fb, (uint32_t)i);
+  });
+  DDSM_ODOMETRY odom;
+  odom.add_wheel(1, DDSM_ODOM_LEFT, 1);
+  odom.add_wheel(2, DDSM_ODOM_RIGHT, -1);
+  fb.model = TYPE_DDSM115;
+  fb.fields = DDSM_FB_SPEED | DDSM_FB_POS;
+  fb.speed = 200;
+  bench("odometry.update (ddsm115 unwrap)", iters, [&](long i) {
+    fb.id = 1 + (i & 1);
+    fb.position = (uint16_t)(i * 37) & 0x7FFF;
+    odom.update(fb, (uint32_t)i * 1000);
+  });
+  ddsm_pose pose;
+  bench("odometry.pose", iters, [&](long) {
+    odom.pose(&pose);
+    sink = pose.updates;
+  });
+  ddsm_cmd drive[DDSM_ODOM_WHEELS];
+  DDSM_MODELS wheel_models;
+  wheel_models.set(2, TYPE_DDSM210);
+  bench("odometry.drive (115 + 210, limited)", iters, [&](long i) {
+    sink = odom.drive((int32_t)(i & 0x7FF), (int32_t)(i & 0xFF) - 128, wheel_models, TYPE_DDSM115, drive,
+                      DDSM_ODOM_WHEELS) + drive[1].cmd;
+  });
+  DDSM_ESTIMATOR est;
+  bench("estimator.update", iters, [&](long i) {
+    fb.id = 1 + (i & 3);
+    fb.speed = (int16_t)(i & 0xFF);
+    est.update(fb, (uint32_t)i * 1000);
+  });
+  ddsm_state state;
+  bench("estimator.state", iters, [&](long i) {
+    est.state(1 + (i & 3), (uint32_t)i * 1000, &state);
+    sink = (int)state.speed;
+  });
+  uint8_t record[DDSM_REC_LENGTH];
+  bench("ddsm_encode_record", iters * 10, [&](long i) {
+    sink = ddsm_encode_record(record, frame, TYPE_DDSM210, false, (uint32_t)i) + record[15];
+  });
+  // records with a JSON line every 8, as the bridge sends them.
+  static uint8_t link[64 * DDSM_REC_LENGTH + 8 * 32];
+  size_t link_len = 0;
+  for (int n = 0; n < 64; n++) {
+    link_len += ddsm_encode_record(link + link_len, frame, TYPE_DDSM210, false, n);
+    if (n % 8 == 7) {
+      const char *line = "{\"T\":20012,\"id\":1,\"req\":12}\n";
+      memcpy(link + link_len, line, strlen(line));
+      link_len += strlen(line);
+    }
+  }
+  DDSM_RECORD_DECODER rec_dec;
+  ddsm_record rec;
+  bench("record decoder (per record)", iters / 8, [&](long) {
+    size_t off = 0;
+    while (off < link_len) {
+      off += rec_dec.feed(link + off, link_len - off);
+      while (rec_dec.next(&rec) != DDSM_REC_NONE) {
+        sink = rec.fb.id;
+      }
+    }
+  }, 64);
+  // a 4 wheel setpoint as the bridge takes it, byte by byte.
+  uint8_t bincmd[DDSM_BINCMD_LENGTH];
+  ddsm_cmd wheels[4] = {{1, 500, 3}, {2, -500, 3}, {3, 500, 3}, {4, -500, 3}};
+  size_t bincmd_len = ddsm_encode_bincmd_ctrl(bincmd, wheels, 4);
+  DDSM_BINCMD_PARSER bincmd_parser;
+  ddsm_cmd parsed[DDSM_BINCMD_MAX];
+  bench("bincmd parse 4 wheel ctrl", iters, [&](long i) {
+    for (size_t k = 0; k < bincmd_len; k++) {
+      if (bincmd_parser.feed(bincmd[k], (uint32_t)i) == DDSM_BINCMD_FRAME) {
+        sink = bincmd_parser.cmds(parsed, DDSM_BINCMD_MAX);
+      }
+    }
+  });
+  ddsm_telemetry_data snap;
+  bench("telemetry.snapshot", iters, [&](long) {
+    tel.snapshot(&snap);
+    sink = snap.count;
+  });
+
+  printf("--- public methods (reply arrives instantly) ---\n");
+  bench("crc8_update", iters * 10, [&](long i) {
+    sink = dc.crc8_update((uint8_t)i, 0x5A);
+  });
+  bench("set_ddsm_type", iters, [&](long) {
+    sink = dc.set_ddsm_type(210);
+  });
+  bench("clear_ddsm_buffer", iters, [&](long) {
+    dc.clear_ddsm_buffer();
+  });
+  bench("ddsm_ctrl", iters, [&](long i) {
+    dc.ddsm_ctrl(1 + (i & 3), 500, 3);
+  });
+  bench("ddsm_get_info", iters, [&](long i) {
+    dc.ddsm_get_info(1 + (i & 3));
+  });
+  bench("ddsm_stop", iters, [&](long i) {
+    dc.ddsm_stop(1 + (i & 3));
+  });
+  bench("ddsm_change_mode", iters, [&](long i) {
+    dc.ddsm_change_mode(1 + (i & 3), 2);
+  });
+  bench("ddsm_id_check", iters, [&](long) {
+    sink = dc.ddsm_id_check();
+  });
+  bench("ddsm_change_id", iters / 10, [&](long) {
+    sink = dc.ddsm_change_id(1);
+  });
+  uint8_t reply[10] = {1, 0x64, 0, 0, 0, 0, 0, 0, 0, 0};
+  reply[9] = crc8_frame(reply, 9);
+  bench("ddsm210_fb", iters, [&](long) {
+    serial.inject(reply, 10);
+    sink = dc.ddsm210_fb();
+  });
+  bench("ddsm115_fb", iters, [&](long) {
+    serial.inject(reply, 10);
+    sink = dc.ddsm115_fb();
+  });
+  dc.set_ddsm_type(210);
+
+  printf("--- non-blocking api ---\n");
+  bench("begin_ctrl + poll", iters, [&](long i) {
+    int h = dc.begin_ctrl(1 + (i & 3), 500, 3);
+    dc.poll();
+    dc.txn_release(h);
+  });
+  bench("begin_get_info + poll", iters, [&](long i) {
+    int h = dc.begin_get_info(1 + (i & 3));
+    dc.poll();
+    dc.txn_release(h);
+  });
+  bench("4x begin_ctrl + poll (per motor)", iters / 4, [&](long) {
+    int h[4];
+    for (int id = 1; id <= 4; id++) {
+      h[id - 1] = dc.begin_ctrl(id, 500, 3);
+    }
+    while (dc.txn_pending() > 0) {
+      dc.poll();
+    }
+    for (int k = 0; k < 4; k++) {
+      dc.txn_release(h[k]);
+    }
+  }, 4);
+
+  ddsm_cmd burst[4];
+  for (int k = 0; k < 4; k++) {
+    burst[k].id = k + 1;
+    burst[k].cmd = 500;
+    burst[k].act = 3;
+  }
+  uint64_t writes = serial.write_calls;
+  bench("ctrl_burst x4 + poll (per motor)", iters / 4, [&](long) {
+    int h[4];
+    dc.begin_ctrl_burst(burst, 4, nullptr, nullptr, h);
+    while (dc.txn_pending() > 0) {
+      dc.poll();
+    }
+    for (int k = 0; k < 4; k++) {
+      dc.txn_release(h[k]);
+    }
+  }, 4);
+  // one frame per write, the bus is half duplex.
+  printf("%-34s %10.2f\n", "  uart writes per burst", (double)(serial.write_calls - writes) / (iters / 4));
+
+  DDSM_BUS bus;
+  bus.begin(&dc, 1000);
+  for (int id = 1; id <= 4; id++) {
+    bus.add_motor(id);
+    bus.set_cmd(id, 500, 3);
+  }
+  bench("DDSM_BUS.run", iters, [&](long) {
+    bus.run();
+  });
+
+  printf("--- timeout path (no motor, real clock) ---\n");
+  ddsm_host_clock_real();
+  bench("ddsm_ctrl to absent id", 20, [&](long) {
+    dc.ddsm_ctrl(9, 500, 3);
+  });
+  bench("begin_ctrl to absent id + poll", 20, [&](long) {
+    int h = dc.begin_ctrl(9, 500, 3);
+    while (dc.txn_status(h) == DDSM_TXN_WAITING) {
+      dc.poll();
+    }
+    dc.txn_release(h);
+  });
+
+  return 0;
+}
@@ -0,0 +1,142 @@
+/*
+load test of DDSM_FLEET: motors spread over several serial ports, each
+one a bus with its own scheduler, usually one motor simulator per port:
+
+  ./build/ddsm_sim -n 4 --link /tmp/ddsm0 &
+  ./build/ddsm_sim -m 5:210 -m 6:210 -m 7:210 -m 8:210 --link /tmp/ddsm1 &
+  ./build/ddsm_fleettest /tmp/ddsm0 /tmp/ddsm1 -n 4 -d 5
+
+bus b gets the ids b*n+1 .. (b+1)*n. every motor gets a ctrl frame per
+cycle at --rate (Hz, default: as fast as the buses go) and every
+--info-every'th cycle an info query. reports replies per second of the
+whole fleet, of every bus and of every motor, and the merged telemetry.
+one port with -n 8 against two with -n 4 shows what the second bus buys.
+
+usage:
+  ddsm_fleettest PORT... [-n MOTORS] [-t 115|210] [-r RATE] [-d SECONDS]
+                 [-b BAUD] [--info-every N]
+*/
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ddsm_fleet.h"
+#include "posix_serial.h"
+
+struct fleet_result {
+  uint64_t done[DDSM_FLEET_MAX_BUSES];
+  uint64_t failed[DDSM_FLEET_MAX_BUSES];
+  DDSM_FLEET *fleet;
+};
+
+static void on_txn(DDSM_BUS *, uint8_t id, int status, bool, void *arg) {
+  fleet_result *r = (fleet_result *)arg;
+  int b = r->fleet->bus_of(id);
+  if (b < 0) {
+    return;
+  }
+  if (status == DDSM_TXN_DONE) {
+    r->done[b]++;
+  } else {
+    r->failed[b]++;
+  }
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: ddsm_fleettest PORT... [-n MOTORS] [-t 115|210] [-r RATE] [-d SECONDS]\n"
+          "                      [-b BAUD] [--info-every N]\n");
+}
+
+int main(int argc, char **argv) {
+  int motors = 4;
+  int type = 210;
+  int rate = 10000;
+  double seconds = 5;
+  unsigned long baud = 115200;
+  int info_every = 10;
+
+  static struct option opts[] = {
+    {"motors", required_argument, 0, 'n'},
+    {"type", required_argument, 0, 't'},
+    {"rate", required_argument, 0, 'r'},
+    {"duration", required_argument, 0, 'd'},
+    {"baud", required_argument, 0, 'b'},
+    {"info-every", required_argument, 0, 1},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "n:t:r:d:b:h", opts, nullptr)) != -1) {
+    switch (c) {
+    case 'n': motors = atoi(optarg); break;
+    case 't': type = atoi(optarg); break;
+    case 'r': rate = atoi(optarg); break;
+    case 'd': seconds = atof(optarg); break;
+    case 'b': baud = atol(optarg); break;
+    case 1: info_every = atoi(optarg); break;
+    default: usage(); return 1;
+    }
+  }
+  int ports = argc - optind;
+  if (ports < 1 || ports > DDSM_FLEET_MAX_BUSES || motors < 1 ||
+      motors > DDSM_BUS_MAX_MOTORS || ports * motors > DDSM_FLEET_MAX_MOTORS) {
+    usage();
+    return 1;
+  }
+
+  PosixSerial serial[DDSM_FLEET_MAX_BUSES];
+  DDSM_CTRL dc[DDSM_FLEET_MAX_BUSES];
+  DDSM_FLEET fleet;
+  fleet_result r = {};
+  r.fleet = &fleet;
+  ddsm_host_clock_real();
+
+  for (int b = 0; b < ports; b++) {
+    if (serial[b].open(argv[optind + b], baud) < 0) {
+      perror(argv[optind + b]);
+      return 1;
+    }
+    dc[b].pSerial = &serial[b];
+    dc[b].set_ddsm_type(type);
+    fleet.add_bus(&dc[b], rate);
+    for (int k = 0; k < motors; k++) {
+      uint8_t id = b * motors + k + 1;
+      fleet.add_motor(id, b);
+      fleet.set_cmd(id, 300, 3);
+    }
+  }
+  fleet.set_info_every(info_every);
+  fleet.set_callback(on_txn, &r);
+
+  uint64_t start = ddsm_host_now_us();
+  uint64_t end = start + (uint64_t)(seconds * 1e6);
+  while (ddsm_host_now_us() < end) {
+    fleet.run();
+  }
+  double elapsed = (ddsm_host_now_us() - start) / 1e6;
+
+  uint64_t done = 0;
+  uint64_t failed = 0;
+  for (int b = 0; b < ports; b++) {
+    done += r.done[b];
+    failed += r.failed[b];
+  }
+  printf("%d bus(es) x %d x DDSM%d, %.1f s\n", ports, motors, type, elapsed);
+  printf("fleet: %.0f replies/s, %llu failed, slowest cycle %.1f Hz\n",
+         done / elapsed, (unsigned long long)failed, fleet.cycle_rate());
+  for (int b = 0; b < ports; b++) {
+    printf("bus %d %s: %.0f replies/s, %llu failed, cycle %.1f Hz\n", b, argv[optind + b],
+           r.done[b] / elapsed, (unsigned long long)r.failed[b], fleet.bus[b].cycle_rate());
+  }
+
+  // one view over every bus.
+  ddsm_telemetry_data tel;
+  fleet.snapshot(&tel);
+  printf("id  bus  model   rate (Hz)  updates\n");
+  for (int i = 0; i < tel.count; i++) {
+    printf("%-3u %3d  %5u %11.1f %8u\n", tel.id[i], fleet.bus_of(tel.id[i]),
+           tel.model[i] == TYPE_DDSM210 ? 210 : 115, fleet.achieved_rate(tel.id[i]), tel.updates[i]);
+  }
+  return 0;
+}
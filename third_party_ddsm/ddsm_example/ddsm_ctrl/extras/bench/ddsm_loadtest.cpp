@@ -0,0 +1,337 @@
+/*
+load test of the ddsm_ctrl library against a serial port, usually the
+motor simulator in extras/sim:
+
+  ./build/ddsm_sim -n 4 --link /tmp/ddsm &
+  ./build/ddsm_loadtest /tmp/ddsm -n 4 -d 5
+
+sends ctrl frames (and every --info-every'th an info query) to the motors
+round robin, one transaction in flight, or with --burst the ctrl frames of
+all motors queued together (still one frame and its reply at a time, the
+bus is half duplex), and reports throughput, latency
+percentiles (request written -> reply decoded), timeouts and crc errors.
+-t auto finds the motors and their models first, for a mixed bus:
+
+  ./build/ddsm_sim -m 1:210 -m 2:210 -m 3:115 -m 4:115 --link /tmp/ddsm &
+  ./build/ddsm_loadtest /tmp/ddsm -n 4 -t auto
+
+with --discover N it scans ids 1..N instead, short-gap sequential
+(DDSM_CTRL::discover) and then one info query at a time with the old
+fixed 4ms timeout, and compares the two.
+--epoll waits in epoll (DdsmLinux) instead of spinning on poll(), the
+cpu line shows what that saves.
+--info-all N reads the info of all motors (absent ones included) N times
+one query after the other, then N times with get_info_all().
+
+usage:
+  ddsm_loadtest PORT [-n MOTORS] [-t 115|210|auto] [-d SECONDS] [-b BAUD]
+                [--info-every N] [--burst] [--retries N] [--absent N]
+                [--fixed-timeout US] [--discover N] [--info-all N] [--epoll]
+*/
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ddsm_ctrl.h"
+#include "ddsm_linux.h"
+
+struct load_result {
+  std::vector<uint32_t> latency_us;
+  uint64_t sent;
+  uint64_t done;
+  uint64_t timeouts;
+  uint64_t crc_errors;
+  uint64_t started_at;
+};
+
+static void on_done(DDSM_CTRL *, int, int status, void *arg) {
+  load_result *r = (load_result *)arg;
+  if (status == DDSM_TXN_DONE) {
+    r->done++;
+    r->latency_us.push_back((uint32_t)(ddsm_host_now_us() - r->started_at));
+  } else if (status == DDSM_TXN_TIMEOUT || status == DDSM_TXN_SHORT) {
+    r->timeouts++;
+  } else if (status == DDSM_TXN_CRC_ERR) {
+    r->crc_errors++;
+  }
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t i = (size_t)(p * (sorted.size() - 1));
+  return sorted[i];
+}
+
+// short-gap scan against the naive one.
+static int discover_test(DDSM_CTRL &dc, int last) {
+  ddsm_motor table[DDSM_DISCOVER_MAX];
+  uint64_t t0 = ddsm_host_now_us();
+  int n = dc.discover(1, last, table, DDSM_DISCOVER_MAX);
+  uint64_t short_gap = ddsm_host_now_us() - t0;
+  printf("id  model  rtt (us)\n");
+  for (int i = 0; i < n; i++) {
+    printf("%-3u %5u %9u\n", table[i].id, table[i].model == TYPE_DDSM210 ? 210 : 115, table[i].rtt_us);
+  }
+
+  dc.set_timeout_limits(TIME0UT * 1000, TIME0UT * 1000);
+  int naive_found = 0;
+  t0 = ddsm_host_now_us();
+  for (int id = 1; id <= last; id++) {
+    if (dc.wait(dc.begin_get_info(id)) == DDSM_TXN_DONE) {
+      naive_found++;
+    }
+  }
+  uint64_t naive = ddsm_host_now_us() - t0;
+  printf("ids 1..%d: short gap %d found in %.1f ms, fixed timeout %d found in %.1f ms\n",
+         last, n, short_gap / 1e3, naive_found, naive / 1e3);
+  return 0;
+}
+
+// info of every motor, one query after the other against one pass.
+static int info_all_test(DDSM_CTRL &dc, int polled, int rounds) {
+  uint8_t ids[DDSM_TXN_QUEUE];
+  for (int k = 0; k < polled; k++) {
+    ids[k] = k + 1;
+  }
+  int serial_ok = 0;
+  uint64_t t0 = ddsm_host_now_us();
+  for (int n = 0; n < rounds; n++) {
+    for (int k = 0; k < polled; k++) {
+      if (dc.wait(dc.begin_get_info(ids[k])) == DDSM_TXN_DONE) {
+        serial_ok++;
+      }
+    }
+  }
+  uint64_t serial = ddsm_host_now_us() - t0;
+
+  ddsm_info info[DDSM_TXN_QUEUE];
+  int pass_ok = 0;
+  t0 = ddsm_host_now_us();
+  for (int n = 0; n < rounds; n++) {
+    int ok = dc.get_info_all(ids, polled, info);
+    if (ok < 0) {
+      fprintf(stderr, "transaction queue full\n");
+      return 1;
+    }
+    pass_ok += ok;
+  }
+  uint64_t pass = ddsm_host_now_us() - t0;
+
+  printf("id  model status  temp  mileage   pos fault\n");
+  for (int k = 0; k < polled; k++) {
+    const ddsm_info &m = info[k];
+    printf("%-3u %5u %6u %5u %8d %5u %5u\n", m.id, dc.model_of(m.id) == TYPE_DDSM210 ? 210 : 115,
+           m.status, m.fb.temperature, m.fb.mileage, m.fb.position, m.fb.fault);
+  }
+  printf("%d ids x %d: one by one %d replies %.2f ms/round, get_info_all %d replies %.2f ms/round\n",
+         polled, rounds, serial_ok, serial / 1e3 / rounds, pass_ok, pass / 1e3 / rounds);
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: ddsm_loadtest PORT [-n MOTORS] [-t 115|210|auto] [-d SECONDS] [-b BAUD]\n"
+          "                     [--info-every N] [--burst] [--retries N] [--absent N]\n"
+          "                     [--fixed-timeout US] [--discover N] [--info-all N] [--epoll]\n");
+}
+
+int main(int argc, char **argv) {
+  int motors = 1;
+  int type = 210;
+  double seconds = 5;
+  unsigned long baud = 115200;
+  int info_every = 10;
+  bool burst = false;
+  int retries = 0;
+  int absent = 0;
+  uint32_t fixed_timeout = 0;
+  int discover = 0;
+  int info_all = 0;
+  bool epoll = false;
+
+  static struct option opts[] = {
+    {"motors", required_argument, 0, 'n'},
+    {"type", required_argument, 0, 't'},
+    {"duration", required_argument, 0, 'd'},
+    {"baud", required_argument, 0, 'b'},
+    {"info-every", required_argument, 0, 1},
+    {"burst", no_argument, 0, 2},
+    {"retries", required_argument, 0, 3},
+    {"absent", required_argument, 0, 4},
+    {"fixed-timeout", required_argument, 0, 5},
+    {"discover", required_argument, 0, 6},
+    {"info-all", required_argument, 0, 7},
+    {"epoll", no_argument, 0, 8},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "n:t:d:b:h", opts, nullptr)) != -1) {
+    switch (c) {
+    case 'n': motors = atoi(optarg); break;
+    case 't': type = atoi(optarg); break;
+    case 'd': seconds = atof(optarg); break;
+    case 'b': baud = atol(optarg); break;
+    case 1: info_every = atoi(optarg); break;
+    case 2: burst = true; break;
+    case 3: retries = atoi(optarg); break;
+    case 4: absent = atoi(optarg); break;
+    case 5: fixed_timeout = atol(optarg); break;
+    case 6: discover = atoi(optarg); break;
+    case 7: info_all = atoi(optarg); break;
+    case 8: epoll = true; break;
+    default: usage(); return 1;
+    }
+  }
+  // --absent: also poll ids motors+1 .. motors+N that don't answer,
+  // like an unplugged wheel.
+  int polled = motors + absent;
+  if (optind >= argc || motors < 1 || polled > DDSM_TXN_QUEUE) {
+    usage();
+    return 1;
+  }
+
+  DdsmLinux dc;
+  if (dc.open(argv[optind], baud) < 0) {
+    perror(argv[optind]);
+    return 1;
+  }
+  if (!epoll) {
+    dc.set_idle(nullptr);
+  }
+  // auto: absent ids are asked as 210s.
+  dc.set_ddsm_type(type == 0 ? 210 : type);
+  dc.set_retries(retries);
+  if (fixed_timeout > 0) {
+    dc.set_timeout_limits(fixed_timeout, fixed_timeout);
+  }
+  ddsm_host_clock_real();
+
+  if (discover > 0) {
+    return discover_test(dc, discover);
+  }
+
+  if (type == 0) {
+    ddsm_motor found[DDSM_DISCOVER_MAX];
+    int n = dc.discover(1, polled, found, DDSM_DISCOVER_MAX);
+    printf("found");
+    for (int i = 0; i < n; i++) {
+      printf(" %u:%u", found[i].id, found[i].model == TYPE_DDSM210 ? 210 : 115);
+    }
+    printf("\n");
+  }
+
+  if (info_all > 0) {
+    return info_all_test(dc, polled, info_all);
+  }
+
+  load_result r;
+  r.sent = 0;
+  r.done = 0;
+  r.timeouts = 0;
+  r.crc_errors = 0;
+  r.latency_us.reserve(1 << 16);
+
+  uint64_t start = ddsm_host_now_us();
+  clock_t cpu_start = clock();
+  uint64_t end = start + (uint64_t)(seconds * 1e6);
+  uint64_t n = 0;
+  while (burst && ddsm_host_now_us() < end) {
+    ddsm_cmd cmds[DDSM_TXN_QUEUE];
+    for (int k = 0; k < polled; k++) {
+      cmds[k].id = k + 1;
+      cmds[k].cmd = (int)(n % 200) - 100;
+      cmds[k].act = 3;
+    }
+    r.started_at = ddsm_host_now_us();
+    if (dc.begin_ctrl_burst(cmds, polled, on_done, &r) < 0) {
+      fprintf(stderr, "transaction queue full\n");
+      return 1;
+    }
+    r.sent += polled;
+    while (dc.txn_pending() > 0) {
+      epoll ? dc.run() : (dc.poll(), 0);
+    }
+    n++;
+  }
+  while (!burst && ddsm_host_now_us() < end) {
+    uint8_t id = 1 + n % polled;
+    bool info = type != 115 && info_every > 0 && (n / polled) % info_every == 0;
+    r.started_at = ddsm_host_now_us();
+    int h = info ? dc.begin_get_info(id, on_done, &r)
+                 : dc.begin_ctrl(id, (int)(n % 200) - 100, 3, on_done, &r);
+    if (h < 0) {
+      fprintf(stderr, "transaction queue full\n");
+      return 1;
+    }
+    r.sent++;
+    while (dc.txn_status(h) == DDSM_TXN_QUEUED || dc.txn_status(h) == DDSM_TXN_WAITING) {
+      epoll ? dc.run() : (dc.poll(), 0);
+    }
+    dc.txn_release(h);
+    n++;
+  }
+  double elapsed = (ddsm_host_now_us() - start) / 1e6;
+  double cpu = (double)(clock() - cpu_start) / CLOCKS_PER_SEC;
+
+  std::sort(r.latency_us.begin(), r.latency_us.end());
+  if (type == 0) {
+    printf("port %s, %d motors + %d absent, %.1f s\n", argv[optind], motors, absent, elapsed);
+  } else {
+    printf("port %s, %d x DDSM%d + %d absent, %.1f s\n", argv[optind], motors, type, absent, elapsed);
+  }
+  printf("transactions %llu (%.0f/s, %.0f/s per motor)\n",
+         (unsigned long long)r.sent, r.sent / elapsed, r.sent / elapsed / motors);
+  printf("replies %llu timeouts %llu crc_errors %llu\n",
+         (unsigned long long)r.done, (unsigned long long)r.timeouts,
+         (unsigned long long)r.crc_errors);
+  printf("cpu %.0f%% of one core (%s), low latency %s\n", 100 * cpu / elapsed,
+         epoll ? "epoll" : "spinning", dc.low_latency() ? "on" : "off");
+  printf("latency us: p50 %u p90 %u p99 %u p99.9 %u max %u\n",
+         percentile(r.latency_us, 0.5), percentile(r.latency_us, 0.9),
+         percentile(r.latency_us, 0.99), percentile(r.latency_us, 0.999),
+         r.latency_us.empty() ? 0 : r.latency_us.back());
+
+  printf("id   requests  replies timeouts crc_err   short unexpect retries\n");
+  for (int i = 0; i <= dc.health.rows; i++) {
+    bool all = i == dc.health.rows;
+    const ddsm_health_row &h = all ? dc.health.total : dc.health.row[i];
+    if (all) {
+      printf("all");
+    } else {
+      printf("%-3u", h.id);
+    }
+    for (int k = 0; k < DDSM_HEALTH_KINDS; k++) {
+      printf(" %8u", h.count[k]);
+    }
+    printf("\n");
+  }
+
+  printf("id   kind  samples   ewma    dev    p99    max timeout (us)\n");
+  for (int i = 0; i < dc.rtt.rows; i++) {
+    for (int k = 0; k < DDSM_RTT_KINDS; k++) {
+      const ddsm_rtt_stats &st = dc.rtt.row[i].kind[k];
+      if (st.samples == 0) {
+        continue;
+      }
+      printf("%-3u  %-4s %8u %6.0f %6.0f %6.0f %6u %6u\n", dc.rtt.row[i].id,
+             k == DDSM_RTT_CTRL ? "ctrl" : "info", st.samples, st.ewma_us, st.dev_us,
+             st.p99_us, st.max_us, dc.rtt.timeout(dc.rtt.row[i].id, k));
+    }
+  }
+
+  // replies decoded with the layout of their motor.
+  ddsm_telemetry_data tel;
+  dc.telemetry.snapshot(&tel);
+  printf("id   model  decoded\n");
+  for (int i = 0; i < tel.count; i++) {
+    printf("%-3u  %5u %8u\n", tel.id[i], tel.model[i] == TYPE_DDSM210 ? 210 : 115, tel.updates[i]);
+  }
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <chrono>
+#include <thread>
+
+#include "ddsm_host.h"
+
+#define CLOCK_REAL   0
+#define CLOCK_MANUAL 1
+#define CLOCK_CUSTOM 2
+
+static int clock_mode = CLOCK_REAL;
+static uint64_t manual_us = 0;
+static uint32_t manual_step_us = 0;
+static ddsm_clock_fn custom_fn = nullptr;
+static void *custom_arg = nullptr;
+
+static uint64_t real_now_us() {
+  static const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - t0).count();
+}
+
+void ddsm_host_clock_real() {
+  clock_mode = CLOCK_REAL;
+}
+
+void ddsm_host_clock_manual(uint32_t step_us) {
+  clock_mode = CLOCK_MANUAL;
+  manual_us = 0;
+  manual_step_us = step_us;
+}
+
+void ddsm_host_set_clock(ddsm_clock_fn fn, void *arg) {
+  if (!fn) {
+    ddsm_host_clock_real();
+    return;
+  }
+  clock_mode = CLOCK_CUSTOM;
+  custom_fn = fn;
+  custom_arg = arg;
+}
+
+void ddsm_host_advance_us(uint64_t us) {
+  manual_us += us;
+}
+
+uint64_t ddsm_host_now_us() {
+  switch (clock_mode) {
+  case CLOCK_MANUAL:
+    manual_us += manual_step_us;
+    return manual_us;
+  case CLOCK_CUSTOM:
+    return custom_fn(custom_arg);
+  default:
+    return real_now_us();
+  }
+}
+
+unsigned long millis() {
+  return (unsigned long)(ddsm_host_now_us() / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)ddsm_host_now_us();
+}
+
+void delayMicroseconds(unsigned int us) {
+  switch (clock_mode) {
+  case CLOCK_MANUAL:
+    manual_us += us;
+    break;
+  case CLOCK_CUSTOM: {
+    uint64_t t0 = custom_fn(custom_arg);
+    while (custom_fn(custom_arg) - t0 < us) {
+      std::this_thread::yield();
+    }
+    break;
+  }
+  default:
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    break;
+  }
+}
+
+void delay(unsigned long ms) {
+  delayMicroseconds(ms * 1000);
+}
+
+void yield() {
+  if (clock_mode == CLOCK_REAL) {
+    std::this_thread::yield();
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef _DDSM_HOST_H
+#define _DDSM_HOST_H
+
+// portability layer for building the ddsm_ctrl library on a host (Linux).
+// provides the small part of the Arduino api the library uses:
+// HardwareSerial as an abstract stream and millis()/micros()/delay()
+// on an injectable clock.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// byte stream the library talks to, implemented by MockSerial
+// (extras/host/mock_serial.h) or a real port.
+class HardwareSerial {
+public:
+	virtual ~HardwareSerial() {}
+
+	virtual int available() = 0;
+	virtual int read() = 0;
+	// non-blocking: returns what is buffered, at most length bytes.
+	virtual size_t readBytes(uint8_t *buffer, size_t length) = 0;
+	virtual size_t write(const uint8_t *buffer, size_t size) = 0;
+	virtual size_t write(uint8_t c) { return write(&c, 1); }
+	virtual int availableForWrite() { return 256; }
+	virtual void flush() {}
+};
+
+// --- clock ---
+// real: steady clock, delay() sleeps (default).
+// manual: time only moves with ddsm_host_advance_us(), delay() and,
+//         if step_us > 0, by step_us on every millis()/micros() call so
+//         timeouts still expire in busy-wait loops.
+// custom: any function returning microseconds.
+typedef uint64_t (*ddsm_clock_fn)(void *arg);
+
+void ddsm_host_clock_real();
+void ddsm_host_clock_manual(uint32_t step_us = 0);
+void ddsm_host_set_clock(ddsm_clock_fn fn, void *arg);
+void ddsm_host_advance_us(uint64_t us);
+uint64_t ddsm_host_now_us();
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+#endif
@@ -0,0 +1,114 @@
+#include "ddsm_linux.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+DdsmLinux::DdsmLinux()
+    : epoll(-1),
+      timer(-1),
+      low_latency_on(false)
+{
+}
+
+DdsmLinux::~DdsmLinux() {
+  close();
+}
+
+int DdsmLinux::open(const char *path, unsigned long baud, bool low_latency) {
+  close();
+  if (port.open(path, baud) < 0) {
+    return -1;
+  }
+  low_latency_on = low_latency && port.set_low_latency(true) > 0;
+
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (epoll < 0 || timer < 0) {
+    close();
+    return -1;
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = port.fd();
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, port.fd(), &ev) < 0) {
+    close();
+    return -1;
+  }
+  ev.events = EPOLLIN;
+  ev.data.fd = timer;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, timer, &ev) < 0) {
+    close();
+    return -1;
+  }
+
+  pSerial = &port;
+  set_idle(on_idle, this);
+  clear_ddsm_buffer();
+  return 1;
+}
+
+void DdsmLinux::close() {
+  if (epoll >= 0) {
+    ::close(epoll);
+    epoll = -1;
+  }
+  if (timer >= 0) {
+    ::close(timer);
+    timer = -1;
+  }
+  port.close();
+  set_idle(nullptr);
+}
+
+void DdsmLinux::on_idle(DDSM_CTRL *, uint32_t wait_us, void *arg) {
+  ((DdsmLinux *)arg)->wait_events(wait_us);
+}
+
+// sleep in epoll until the port is readable or wait_us (> 0) passed.
+// returns 1 if the port is readable, 0 on timeout.
+int DdsmLinux::wait_events(uint32_t wait_us) {
+  if (epoll < 0) {
+    return -1;
+  }
+  struct itimerspec its = {};
+  its.it_value.tv_sec = wait_us / 1000000;
+  its.it_value.tv_nsec = (long)(wait_us % 1000000) * 1000;
+  timerfd_settime(timer, 0, &its, nullptr);
+
+  struct epoll_event evs[2];
+  int n;
+  do {
+    n = epoll_wait(epoll, evs, 2, -1);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    return -1;
+  }
+  int readable = 0;
+  for (int i = 0; i < n; i++) {
+    if (evs[i].data.fd == timer) {
+      uint64_t expirations;
+      if (::read(timer, &expirations, sizeof(expirations)) < 0) {
+        // already drained.
+      }
+    } else {
+      readable = 1;
+    }
+  }
+  return readable;
+}
+
+int DdsmLinux::run(int timeout_ms) {
+  poll();
+  uint32_t wait_us = idle_us();
+  if (timeout_ms >= 0 && (wait_us == 0 || (uint32_t)timeout_ms * 1000 < wait_us)) {
+    wait_us = (uint32_t)timeout_ms * 1000;
+  }
+  if (wait_us == 0) {
+    return port.available() > 0 ? 1 : 0;
+  }
+  int r = wait_events(wait_us);
+  poll();
+  return r;
+}
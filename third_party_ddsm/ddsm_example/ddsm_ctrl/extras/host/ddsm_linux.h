@@ -0,0 +1,46 @@
+#ifndef _DDSM_LINUX_H
+#define _DDSM_LINUX_H
+
+#include "ddsm_ctrl.h"
+#include "posix_serial.h"
+
+// DDSM_CTRL driving the motor bus straight from a Linux host through a
+// USB-RS485 adapter, no ESP32 bridge in between.
+// the port is raw 8N1, non-blocking (VMIN = VTIME = 0), low latency.
+// waiting is event driven: epoll on the port and a timerfd armed with
+// the next reply deadline, so the blocking methods and run() sleep until
+// a byte arrives or a timeout is due instead of spinning on poll().
+// every public method of DDSM_CTRL works as on the board.
+class DdsmLinux : public DDSM_CTRL {
+public:
+	DdsmLinux();
+	~DdsmLinux();
+
+	// returns 1, -1 on error (errno is set). low_latency failing
+	// (pseudo-terminals) is not an error, see low_latency().
+	int open(const char *path, unsigned long baud = DDSM_BAUDRATE, bool low_latency = true);
+	void close();
+
+	// one step of the event loop: sleep until the port has data, the
+	// active transaction times out or timeout_ms passed, then poll().
+	// -1: sleep only while a reply is due, 0: never sleep.
+	// returns 1 if the port had data, 0 if not, -1 on error.
+	int run(int timeout_ms = -1);
+
+	// epoll fd, readable when run() has something to do, to nest the
+	// driver into another event loop.
+	int fd() { return epoll; }
+	bool low_latency() { return low_latency_on; }
+
+	PosixSerial port;
+
+private:
+	static void on_idle(DDSM_CTRL *dc, uint32_t wait_us, void *arg);
+	int wait_events(uint32_t wait_us);
+
+	int epoll;
+	int timer;
+	bool low_latency_on;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "mock_serial.h"
+
+MockSerial::MockSerial()
+    : bytes_written(0),
+      write_calls(0),
+      responder(nullptr),
+      responder_arg(nullptr),
+      keep(true)
+{
+}
+
+int MockSerial::available() {
+  return (int)rx.size();
+}
+
+int MockSerial::read() {
+  if (rx.empty()) {
+    return -1;
+  }
+  int c = rx.front();
+  rx.pop_front();
+  return c;
+}
+
+size_t MockSerial::readBytes(uint8_t *buffer, size_t length) {
+  size_t n = 0;
+  while (n < length && !rx.empty()) {
+    buffer[n++] = rx.front();
+    rx.pop_front();
+  }
+  return n;
+}
+
+size_t MockSerial::write(const uint8_t *buffer, size_t size) {
+  bytes_written += size;
+  write_calls++;
+  if (keep) {
+    tx.insert(tx.end(), buffer, buffer + size);
+  }
+  if (responder) {
+    responder(this, buffer, size, responder_arg);
+  }
+  return size;
+}
+
+void MockSerial::inject(const uint8_t *data, size_t length) {
+  rx.insert(rx.end(), data, data + length);
+}
+
+size_t MockSerial::take_tx(uint8_t *out, size_t length) {
+  size_t n = 0;
+  while (n < length && !tx.empty()) {
+    out[n++] = tx.front();
+    tx.pop_front();
+  }
+  return n;
+}
+
+size_t MockSerial::tx_pending() {
+  return tx.size();
+}
+
+void MockSerial::set_responder(mock_responder fn, void *arg) {
+  responder = fn;
+  responder_arg = arg;
+}
+
+// false: written bytes only go to the responder (benchmarks).
+void MockSerial::keep_tx(bool k) {
+  keep = k;
+  if (!keep) {
+    tx.clear();
+  }
+}
+
+void MockSerial::clear() {
+  rx.clear();
+  tx.clear();
+}
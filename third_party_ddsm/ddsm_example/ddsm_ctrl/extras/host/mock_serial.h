@@ -0,0 +1,44 @@
+#ifndef _MOCK_SERIAL_H
+#define _MOCK_SERIAL_H
+
+#include <deque>
+
+#include "ddsm_host.h"
+
+class MockSerial;
+
+// called with every write of the driver, e.g. to inject motor replies.
+typedef void (*mock_responder)(MockSerial *serial, const uint8_t *data, size_t length, void *arg);
+
+// in-memory serial port for host builds.
+// the driver side reads what inject() put in, everything it writes is
+// kept until take_tx() (or handed to the responder).
+class MockSerial : public HardwareSerial {
+public:
+	MockSerial();
+
+	int available() override;
+	int read() override;
+	size_t readBytes(uint8_t *buffer, size_t length) override;
+	size_t write(const uint8_t *buffer, size_t size) override;
+
+	// bus side.
+	void inject(const uint8_t *data, size_t length);
+	size_t take_tx(uint8_t *out, size_t length);
+	size_t tx_pending();
+	void set_responder(mock_responder fn, void *arg);
+	void keep_tx(bool keep);
+	void clear();
+
+	uint64_t bytes_written;
+	uint64_t write_calls;
+
+private:
+	std::deque<uint8_t> rx;
+	std::deque<uint8_t> tx;
+	mock_responder responder;
+	void *responder_arg;
+	bool keep;
+};
+
+#endif
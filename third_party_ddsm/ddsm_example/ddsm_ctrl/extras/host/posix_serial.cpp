@@ -0,0 +1,129 @@
+#include "posix_serial.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
+
+static speed_t baud_constant(unsigned long baud) {
+  switch (baud) {
+  case 9600: return B9600;
+  case 19200: return B19200;
+  case 38400: return B38400;
+  case 57600: return B57600;
+  case 115200: return B115200;
+  case 230400: return B230400;
+#ifdef B460800
+  case 460800: return B460800;
+#endif
+#ifdef B921600
+  case 921600: return B921600;
+#endif
+  }
+  return B115200;
+}
+
+PosixSerial::PosixSerial()
+    : port(-1)
+{
+}
+
+PosixSerial::~PosixSerial() {
+  close();
+}
+
+int PosixSerial::open(const char *path, unsigned long baud) {
+  close();
+  port = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (port < 0) {
+    return -1;
+  }
+  struct termios tio;
+  if (tcgetattr(port, &tio) == 0) {
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    // reads return what is there at once, never wait for more.
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, baud_constant(baud));
+    cfsetospeed(&tio, baud_constant(baud));
+    tcsetattr(port, TCSANOW, &tio);
+    tcflush(port, TCIOFLUSH);
+  }
+  return 1;
+}
+
+int PosixSerial::set_low_latency(bool on) {
+#ifdef __linux__
+  struct serial_struct ss;
+  if (port < 0 || ioctl(port, TIOCGSERIAL, &ss) < 0) {
+    return -1;
+  }
+  if (on) {
+    ss.flags |= ASYNC_LOW_LATENCY;
+  } else {
+    ss.flags &= ~ASYNC_LOW_LATENCY;
+  }
+  return ioctl(port, TIOCSSERIAL, &ss) < 0 ? -1 : 1;
+#else
+  (void)on;
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+void PosixSerial::close() {
+  if (port >= 0) {
+    ::close(port);
+    port = -1;
+  }
+}
+
+int PosixSerial::available() {
+  int n = 0;
+  if (port < 0 || ioctl(port, FIONREAD, &n) < 0) {
+    return 0;
+  }
+  return n;
+}
+
+int PosixSerial::read() {
+  uint8_t c;
+  if (port < 0 || ::read(port, &c, 1) != 1) {
+    return -1;
+  }
+  return c;
+}
+
+size_t PosixSerial::readBytes(uint8_t *buffer, size_t length) {
+  if (port < 0 || length == 0) {
+    return 0;
+  }
+  ssize_t n = ::read(port, buffer, length);
+  return n > 0 ? (size_t)n : 0;
+}
+
+// blocks until everything is handed to the kernel.
+size_t PosixSerial::write(const uint8_t *buffer, size_t size) {
+  size_t done = 0;
+  while (port >= 0 && done < size) {
+    ssize_t n = ::write(port, buffer + done, size - done);
+    if (n > 0) {
+      done += n;
+    } else if (n < 0 && errno == EAGAIN) {
+      struct pollfd pfd;
+      pfd.fd = port;
+      pfd.events = POLLOUT;
+      poll(&pfd, 1, 10);
+    } else if (n < 0 && errno != EINTR) {
+      break;
+    }
+  }
+  return done;
+}
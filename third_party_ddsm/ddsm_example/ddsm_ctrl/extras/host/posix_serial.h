@@ -0,0 +1,35 @@
+#ifndef _POSIX_SERIAL_H
+#define _POSIX_SERIAL_H
+
+#include "ddsm_host.h"
+
+// serial port / pseudo-terminal on a POSIX host, raw 8N1, non-blocking
+// reads. used to run the library against extras/sim/ddsm_sim or a
+// USB-RS485 adapter.
+class PosixSerial : public HardwareSerial {
+public:
+	PosixSerial();
+	~PosixSerial();
+
+	// baud: 9600 .. 921600, ignored by pseudo-terminals.
+	// returns 1 on success, -1 on error (errno is set).
+	int open(const char *path, unsigned long baud);
+	void close();
+	int fd() { return port; }
+
+	// ASYNC_LOW_LATENCY, as serialport's linuxSetLowLatencyMode: a
+	// USB-serial adapter hands received bytes over right away instead
+	// of batching them (ftdi: 16ms latency timer -> 1ms).
+	// returns 1, -1 if the driver doesn't support it (pseudo-terminals).
+	int set_low_latency(bool on);
+
+	int available() override;
+	int read() override;
+	size_t readBytes(uint8_t *buffer, size_t length) override;
+	size_t write(const uint8_t *buffer, size_t size) override;
+
+private:
+	int port;
+};
+
+#endif
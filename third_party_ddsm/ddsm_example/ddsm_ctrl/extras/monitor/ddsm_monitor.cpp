@@ -0,0 +1,176 @@
+/*
+reads the usb link of the bridge firmware (ddsm_example) and prints what
+comes back: JSON lines as they are, binary telemetry records
+(CMD_DDSM_FB_MODE, ddsm_record.h) decoded, one line each:
+
+  ./build/ddsm_monitor /dev/ttyUSB0 --bin
+
+--bin / --json switch the firmware's reply format first. --ctrl ID:CMD
+(repeated for several motors) sends setpoints as binary frames
+(ddsm_bincmd.h), once or -r RATE times per second, act --act (3):
+
+  ./build/ddsm_monitor /dev/ttyUSB0 --bin -q -r 200 --ctrl 1:50 --ctrl 2:-50
+ the totals
+(records and lines per second, stray sync bytes) are printed after
+-d SECONDS or ctrl-c, -q prints only those.
+
+usage:
+  ddsm_monitor PORT [-b BAUD] [-d SECONDS] [--bin | --json] [-q]
+               [--ctrl ID:CMD]... [-r RATE] [--act ACT]
+*/
+
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ddsm_bincmd.h"
+#include "ddsm_record.h"
+#include "posix_serial.h"
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int) {
+  running = 0;
+}
+
+static void print_record(const ddsm_record &r) {
+  const ddsm_feedback &fb = r.fb;
+  printf("us=%u id=%u typ=%d%s", r.time_us, fb.id, fb.model == TYPE_DDSM210 ? 210 : 115,
+         r.info ? " info" : "");
+  if (fb.fields & DDSM_FB_MODE) printf(" mode=%u", fb.mode);
+  if (fb.fields & DDSM_FB_SPEED) printf(" spd=%d", fb.speed);
+  if (fb.fields & DDSM_FB_CURRENT) printf(" crt=%d", fb.current);
+  if (fb.fields & DDSM_FB_ACC_TIME) printf(" act=%u", fb.acc_time);
+  if (fb.fields & DDSM_FB_TEMP) printf(" tep=%u", fb.temperature);
+  if (fb.fields & DDSM_FB_U8) printf(" u8=%u", fb.u8);
+  if (fb.fields & DDSM_FB_POS) printf(" pos=%u", fb.position);
+  if (fb.fields & DDSM_FB_MILEAGE) printf(" mil=%d", fb.mileage);
+  if (fb.fields & DDSM_FB_FAULT) printf(" err=%u", fb.fault);
+  printf("\n");
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: ddsm_monitor PORT [-b BAUD] [-d SECONDS] [--bin | --json] [-q]\n"
+          "                    [--ctrl ID:CMD]... [-r RATE] [--act ACT]\n");
+}
+
+int main(int argc, char **argv) {
+  unsigned long baud = 115200;
+  double seconds = 0;
+  int mode = -1;
+  bool quiet = false;
+  ddsm_cmd setpoints[DDSM_BINCMD_MAX];
+  int count = 0;
+  int rate = 0;
+  int act = 3;
+
+  static struct option opts[] = {
+    {"bin", no_argument, 0, 1},
+    {"json", no_argument, 0, 2},
+    {"ctrl", required_argument, 0, 3},
+    {"act", required_argument, 0, 4},
+    {0, 0, 0, 0},
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "b:d:r:qh", opts, nullptr)) != -1) {
+    switch (c) {
+    case 'b': baud = strtoul(optarg, nullptr, 10); break;
+    case 'd': seconds = atof(optarg); break;
+    case 'q': quiet = true; break;
+    case 'r': rate = atoi(optarg); break;
+    case 1: mode = 1; break;
+    case 2: mode = 0; break;
+    case 3:
+      if (count >= DDSM_BINCMD_MAX) {
+        fprintf(stderr, "at most %d --ctrl\n", DDSM_BINCMD_MAX);
+        return 1;
+      }
+      setpoints[count].id = atoi(optarg);
+      setpoints[count].cmd = strchr(optarg, ':') ? atoi(strchr(optarg, ':') + 1) : 0;
+      count++;
+      break;
+    case 4: act = atoi(optarg); break;
+    default: usage(); return 1;
+    }
+  }
+  if (optind != argc - 1) {
+    usage();
+    return 1;
+  }
+
+  PosixSerial serial;
+  if (serial.open(argv[optind], baud) < 0) {
+    perror(argv[optind]);
+    return 1;
+  }
+  if (mode >= 0) {
+    char cmd[32];
+    int n = snprintf(cmd, sizeof(cmd), "{\"T\":11007,\"bin\":%d}\n", mode);
+    serial.write((const uint8_t *)cmd, n);
+  }
+
+  for (int i = 0; i < count; i++) {
+    setpoints[i].act = act;
+  }
+  uint8_t frame[DDSM_BINCMD_LENGTH];
+  size_t frame_len = ddsm_encode_bincmd_ctrl(frame, setpoints, count);
+  uint64_t sent = 0;
+  uint64_t next_send = 0;
+
+  DDSM_RECORD_DECODER dec;
+  ddsm_record rec;
+  uint8_t buf[DDSM_REC_WINDOW];
+  uint64_t start = ddsm_host_now_us();
+  uint64_t end = seconds > 0 ? start + (uint64_t)(seconds * 1e6) : 0;
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  while (running && (end == 0 || ddsm_host_now_us() < end)) {
+    int wait_ms = 100;
+    if (frame_len > 0 && (sent == 0 || rate > 0)) {
+      uint64_t now = ddsm_host_now_us();
+      if (now >= next_send) {
+        serial.write(frame, frame_len);
+        sent++;
+        next_send = rate > 0 ? (next_send ? next_send : now) + 1000000 / rate : 0;
+      }
+      if (rate > 0) {
+        wait_ms = next_send > now ? (int)((next_send - now) / 1000) : 0;
+      }
+    }
+    struct pollfd p = {serial.fd(), POLLIN, 0};
+    if (::poll(&p, 1, wait_ms) < 0) {
+      break;
+    }
+    size_t n;
+    while ((n = serial.readBytes(buf, sizeof(buf))) > 0) {
+      size_t off = 0;
+      while (off < n) {
+        off += dec.feed(buf + off, n - off);
+        int kind;
+        while ((kind = dec.next(&rec)) != DDSM_REC_NONE) {
+          if (quiet) {
+            continue;
+          }
+          if (kind == DDSM_REC_RECORD) {
+            print_record(rec);
+          } else {
+            printf("%s\n", dec.line());
+          }
+        }
+      }
+    }
+    fflush(stdout);
+  }
+
+  double elapsed = (ddsm_host_now_us() - start) / 1e6;
+  if (sent > 0) {
+    fprintf(stderr, "sent %llu setpoint frames of %zu bytes (%.0f/s)\n", (unsigned long long)sent,
+            frame_len, sent / elapsed);
+  }
+  fprintf(stderr, "records %u (%.0f/s) lines %u (%.0f/s) stray sync bytes %u\n", dec.records,
+          dec.records / elapsed, dec.lines, dec.lines / elapsed, dec.dropped);
+  return 0;
+}
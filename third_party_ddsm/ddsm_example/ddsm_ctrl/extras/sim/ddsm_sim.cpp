@@ -0,0 +1,477 @@
+/*
+DDSM115 / DDSM210 bus simulator.
+opens a pseudo-terminal and answers like N motors on one RS485 bus:
+0x64 ctrl, 0x74 info, 0xA0 mode change, 0xC8 id check and
+0xAA 0x55 0x53 id change, with the byte layouts of ddsm_ctrl.cpp.
+
+bytes move at the real wire speed (10 bits per byte at --baud), replies
+start --latency us after the last request byte, and reply bytes can be
+dropped (--loss) or bit-flipped (--corrupt) at random.
+the bus is half duplex and nobody arbitrates: bytes on the wire at the
+same time, host and motor or two motors, garble each other (dominant
+low bits win). a motor doesn't see a garbled frame, the host gets the
+garbled reply bytes. --no-timing turns that off with the wire speed.
+
+usage:
+  ddsm_sim [-m ID:MODEL]... [-n COUNT] [-t 115|210] [-l LATENCY_US]
+           [--loss P] [--corrupt P] [-b BAUD] [--link PATH] [--no-timing]
+           [--seed N] [-v]
+  e.g. ddsm_sim -n 4 -t 210 --link /tmp/ddsm
+  prints the slave device path, point DDSM_CTRL / serialport at it.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "ddsm_crc.h"
+#include "sim_motor.h"
+
+struct sim_config {
+  unsigned long baud;
+  uint32_t latency_us;
+  double loss;
+  double corrupt;
+  bool timing;
+  bool verbose;
+  const char *link;
+  unsigned seed;
+};
+
+struct tx_byte {
+  uint64_t at;   // send time (us)
+  uint8_t data;
+  uint32_t reply; // which reply it belongs to
+};
+
+struct sim_stats {
+  uint64_t frames;
+  uint64_t replies;
+  uint64_t unknown_id;
+  uint64_t lost;
+  uint64_t corrupted;
+  uint64_t collisions;
+};
+
+static volatile sig_atomic_t running = 1;
+
+static void on_signal(int) {
+  running = 0;
+}
+
+static uint64_t now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+class sim_bus {
+public:
+  sim_bus(const sim_config &c)
+      : cfg(c), rng(c.seed), rx_len(0), rx_wire_at(0), last_sent{}, replies(0), last_step(0) {
+    byte_us = c.timing ? 10.0 * 1e6 / c.baud : 0;
+    memset(&stats, 0, sizeof(stats));
+  }
+
+  std::vector<sim_motor> motors;
+  std::deque<tx_byte> out;
+  sim_stats stats;
+
+  // bytes from the host, t: when read from the pty.
+  void receive(const uint8_t *data, size_t length, uint64_t t) {
+    bool hit = false;
+    for (size_t i = 0; i < length; i++) {
+      // a byte can't finish before the previous one plus one byte time.
+      uint64_t start = rx_wire_at > t ? rx_wire_at : t;
+      rx_wire_at = start + (uint64_t)byte_us;
+
+      if (rx_len == sizeof(rx)) {
+        memmove(rx, rx + 1, rx_len - 1);
+        rx_len--;
+      }
+      rx[rx_len++] = collide(data[i], start, &hit);
+      if (rx_len >= 10 && is_frame(rx + rx_len - 10)) {
+        handle(rx + rx_len - 10, rx_wire_at);
+        rx_len = 0;
+      }
+    }
+    if (hit) {
+      stats.collisions++;
+    }
+  }
+
+  // when the next reply byte is done on the wire, out must not be empty.
+  uint64_t next_due() const {
+    return out.front().at + (uint64_t)byte_us;
+  }
+
+  // reply bytes done on the wire at t into chunk, returns how many.
+  size_t transmit(uint64_t t, uint8_t *chunk, size_t max) {
+    size_t n = 0;
+    while (!out.empty() && out.front().at + (uint64_t)byte_us <= t && n < max) {
+      chunk[n++] = out.front().data;
+      last_sent = out.front();
+      out.pop_front();
+    }
+    return n;
+  }
+
+  // advance every motor to time t.
+  void step(uint64_t t) {
+    if (last_step == 0) {
+      last_step = t;
+      return;
+    }
+    double dt = (t - last_step) / 1e6;
+    last_step = t;
+    for (size_t i = 0; i < motors.size(); i++) {
+      motors[i].step(dt);
+    }
+  }
+
+private:
+  // crc ok, or the 115 mode frame which carries the mode instead of a crc.
+  bool is_frame(const uint8_t *f) {
+    if (crc8_check(f, 10)) {
+      return true;
+    }
+    if (f[1] != 0xA0) {
+      return false;
+    }
+    for (int i = 2; i < 9; i++) {
+      if (f[i] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  sim_motor *find(uint8_t id) {
+    for (size_t i = 0; i < motors.size(); i++) {
+      if (motors[i].id == id) {
+        return &motors[i];
+      }
+    }
+    return nullptr;
+  }
+
+  // on the wire at the same time: [a, a + byte_us) and [b, b + byte_us).
+  bool overlap(uint64_t a, uint64_t b) {
+    return a < b + (uint64_t)byte_us && b < a + (uint64_t)byte_us;
+  }
+
+  // a host byte starting at t: the motors hear it garbled by any reply
+  // byte on the wire then, which is garbled too.
+  uint8_t collide(uint8_t b, uint64_t t, bool *hit) {
+    if (last_sent.reply && overlap(last_sent.at, t)) {
+      // already went to the host intact, the motors still hear the mix.
+      b &= last_sent.data;
+      *hit = true;
+    }
+    for (size_t k = 0; k < out.size() && out[k].at < t + (uint64_t)byte_us; k++) {
+      if (overlap(out[k].at, t)) {
+        out[k].data &= b;
+        b = out[k].data;
+        *hit = true;
+      }
+    }
+    return b;
+  }
+
+  // queue a reply, t: end of the request on the wire.
+  // bytes that meet a queued reply byte merge with it (wired and).
+  void reply(const uint8_t *frame, uint64_t t) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    uint64_t start = t + cfg.latency_us;
+    bool hit = false;
+    replies++;
+    for (int i = 0; i < 10; i++) {
+      uint8_t b = frame[i];
+      if (cfg.loss > 0 && u(rng) < cfg.loss) {
+        stats.lost++;
+        continue;
+      }
+      if (cfg.corrupt > 0 && u(rng) < cfg.corrupt) {
+        b ^= (uint8_t)(1 << (rng() % 8));
+        stats.corrupted++;
+      }
+      tx_byte tb;
+      tb.at = start + (uint64_t)(i * byte_us);
+      tb.data = b;
+      tb.reply = replies;
+      bool merged = false;
+      for (size_t k = 0; k < out.size() && !merged; k++) {
+        if (out[k].reply != replies && overlap(out[k].at, tb.at)) {
+          out[k].data &= b;
+          merged = true;
+        }
+      }
+      if (merged) {
+        hit = true;
+      } else {
+        out.push_back(tb);
+      }
+    }
+    if (hit) {
+      stats.collisions++;
+    }
+    stats.replies++;
+  }
+
+  void handle(const uint8_t *f, uint64_t t) {
+    uint8_t r[10];
+    stats.frames++;
+    step(now_us());
+
+    // id change, only one motor should be connected.
+    if (f[0] == 0xAA && f[1] == 0x55 && f[2] == 0x53) {
+      for (size_t i = 0; i < motors.size(); i++) {
+        if (!motors[i].id_changed) {
+          motors[i].id = f[3];
+          motors[i].id_changed = true;
+        }
+      }
+      return;
+    }
+
+    // id check, every motor answers: more than one collides on the bus.
+    if (f[0] == 0xC8 && f[1] == 0x64) {
+      if (motors.empty()) {
+        return;
+      }
+      motors[0].feedback(r);
+      if (motors.size() > 1) {
+        uint8_t other[10];
+        for (size_t i = 1; i < motors.size(); i++) {
+          motors[i].feedback(other);
+          for (int k = 0; k < 10; k++) {
+            r[k] &= other[k]; // dominant low bits win
+          }
+        }
+        stats.collisions++;
+      }
+      reply(r, t);
+      return;
+    }
+
+    sim_motor *m = find(f[0]);
+    if (!m) {
+      stats.unknown_id++;
+      return;
+    }
+    switch (f[1]) {
+    case 0x64:
+      m->ctrl((f[2] << 8) | f[3], f[6]);
+      m->feedback(r);
+      reply(r, t);
+      break;
+    case 0x74:
+      m->info(r);
+      reply(r, t);
+      break;
+    case 0xA0:
+      m->mode = m->model == TYPE_DDSM210 ? f[2] : f[9];
+      break;
+    }
+  }
+
+  sim_config cfg;
+  std::mt19937 rng;
+  double byte_us;
+  uint8_t rx[32];
+  size_t rx_len;
+  uint64_t rx_wire_at;
+  tx_byte last_sent; // last reply byte handed to the host
+  uint32_t replies;
+  uint64_t last_step;
+};
+
+static void usage() {
+  fprintf(stderr,
+          "usage: ddsm_sim [-m ID:MODEL]... [-n COUNT] [-t 115|210] [-l LATENCY_US]\n"
+          "                [--loss P] [--corrupt P] [-b BAUD] [--link PATH]\n"
+          "                [--no-timing] [--seed N] [-v]\n");
+}
+
+static void print_stats(const sim_stats &s) {
+  fprintf(stderr, "frames %llu replies %llu unknown_id %llu lost %llu corrupted %llu collisions %llu\n",
+          (unsigned long long)s.frames, (unsigned long long)s.replies,
+          (unsigned long long)s.unknown_id, (unsigned long long)s.lost,
+          (unsigned long long)s.corrupted, (unsigned long long)s.collisions);
+}
+
+int main(int argc, char **argv) {
+  sim_config cfg;
+  cfg.baud = 115200;
+  cfg.latency_us = 300;
+  cfg.loss = 0;
+  cfg.corrupt = 0;
+  cfg.timing = true;
+  cfg.verbose = false;
+  cfg.link = nullptr;
+  cfg.seed = 1;
+
+  int count = 0;
+  int model = TYPE_DDSM210;
+  std::vector<sim_motor> motors;
+
+  static struct option opts[] = {
+    {"motor", required_argument, 0, 'm'},
+    {"count", required_argument, 0, 'n'},
+    {"type", required_argument, 0, 't'},
+    {"latency", required_argument, 0, 'l'},
+    {"baud", required_argument, 0, 'b'},
+    {"loss", required_argument, 0, 1},
+    {"corrupt", required_argument, 0, 2},
+    {"link", required_argument, 0, 3},
+    {"no-timing", no_argument, 0, 4},
+    {"seed", required_argument, 0, 5},
+    {"verbose", no_argument, 0, 'v'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "m:n:t:l:b:vh", opts, nullptr)) != -1) {
+    switch (c) {
+    case 'm': {
+      int id = 0, typ = 0;
+      if (sscanf(optarg, "%d:%d", &id, &typ) != 2 || id <= 0 || id > 253) {
+        usage();
+        return 1;
+      }
+      sim_motor m;
+      m.init(id, typ == 115 ? TYPE_DDSM115 : TYPE_DDSM210);
+      motors.push_back(m);
+      break;
+    }
+    case 'n': count = atoi(optarg); break;
+    case 't': model = atoi(optarg) == 115 ? TYPE_DDSM115 : TYPE_DDSM210; break;
+    case 'l': cfg.latency_us = atoi(optarg); break;
+    case 'b': cfg.baud = atol(optarg); break;
+    case 1: cfg.loss = atof(optarg); break;
+    case 2: cfg.corrupt = atof(optarg); break;
+    case 3: cfg.link = optarg; break;
+    case 4: cfg.timing = false; break;
+    case 5: cfg.seed = atoi(optarg); break;
+    case 'v': cfg.verbose = true; break;
+    default: usage(); return 1;
+    }
+  }
+  for (int id = 1; id <= count; id++) {
+    sim_motor m;
+    m.init(id, model);
+    motors.push_back(m);
+  }
+  if (motors.empty()) {
+    sim_motor m;
+    m.init(1, model);
+    motors.push_back(m);
+  }
+
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+    perror("posix_openpt");
+    return 1;
+  }
+  const char *slave_name = ptsname(master);
+
+  // raw mode on the slave side; keeping it open avoids EIO on the master
+  // while no client is connected.
+  int slave = open(slave_name, O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    perror(slave_name);
+    return 1;
+  }
+  struct termios tio;
+  tcgetattr(slave, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slave, TCSANOW, &tio);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+  if (cfg.link) {
+    unlink(cfg.link);
+    if (symlink(slave_name, cfg.link) < 0) {
+      perror(cfg.link);
+    }
+  }
+  printf("%s\n", cfg.link ? cfg.link : slave_name);
+  fflush(stdout);
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  sim_bus bus(cfg);
+  bus.motors = motors;
+
+  uint64_t next_report = now_us() + 1000000;
+  sim_stats last;
+  memset(&last, 0, sizeof(last));
+
+  while (running) {
+    uint64_t now = now_us();
+
+    // send the reply bytes that are due, in one write.
+    uint8_t chunk[256];
+    size_t n = bus.transmit(now, chunk, sizeof(chunk));
+    if (n > 0 && write(master, chunk, n) < 0 && errno != EAGAIN) {
+      perror("write");
+      break;
+    }
+
+    // sleep until the next byte is due or the host sends something.
+    uint64_t wait_us = 10000;
+    if (!bus.out.empty()) {
+      uint64_t at = bus.next_due();
+      wait_us = at > now ? at - now : 0;
+    }
+    struct pollfd pfd;
+    pfd.fd = master;
+    pfd.events = POLLIN;
+    struct timespec ts;
+    ts.tv_sec = wait_us / 1000000;
+    ts.tv_nsec = (wait_us % 1000000) * 1000;
+    int r = ppoll(&pfd, 1, &ts, nullptr);
+    if (r < 0 && errno != EINTR) {
+      perror("ppoll");
+      break;
+    }
+
+    now = now_us();
+    if (r > 0 && (pfd.revents & POLLIN)) {
+      uint8_t buf[256];
+      ssize_t got = read(master, buf, sizeof(buf));
+      if (got > 0) {
+        bus.receive(buf, got, now);
+      }
+    }
+    bus.step(now);
+
+    if (cfg.verbose && now >= next_report) {
+      next_report += 1000000;
+      fprintf(stderr, "%llu frames/s, %llu replies/s | ",
+              (unsigned long long)(bus.stats.frames - last.frames),
+              (unsigned long long)(bus.stats.replies - last.replies));
+      print_stats(bus.stats);
+      last = bus.stats;
+    }
+  }
+
+  print_stats(bus.stats);
+  if (cfg.link) {
+    unlink(cfg.link);
+  }
+  close(slave);
+  close(master);
+  return 0;
+}
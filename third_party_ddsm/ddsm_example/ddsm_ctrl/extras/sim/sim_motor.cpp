@@ -0,0 +1,146 @@
+#include <math.h>
+
+#include "ddsm_crc.h"
+#include "sim_motor.h"
+
+void sim_motor::init(uint8_t motor_id, uint8_t motor_model) {
+  id = motor_id;
+  model = motor_model;
+  mode = 2;
+  cmd = 0;
+  act = 1;
+  rpm = 0;
+  turns = 0;
+  current = 0;
+  temperature = 25;
+  fault = 0;
+  id_changed = false;
+}
+
+double sim_motor::max_rpm() {
+  return model == TYPE_DDSM210 ? 210.0 : 200.0;
+}
+
+uint16_t sim_motor::position() {
+  double frac = turns - floor(turns);
+  return (uint16_t)(frac * 32768.0) & 0x7FFF;
+}
+
+void sim_motor::ctrl(int command, uint8_t acc_time) {
+  cmd = (int16_t)command;
+  act = acc_time;
+}
+
+void sim_motor::step(double dt) {
+  double target = 0;
+  double limit = max_rpm();
+
+  if (mode == 2) {
+    // speed loop, 115: rpm, 210: 0.1 rpm
+    target = model == TYPE_DDSM210 ? cmd / 10.0 : cmd;
+  } else if (mode == 3) {
+    // position loop, shortest path to the goal at a fixed speed.
+    double goal = (cmd & 0x7FFF) / 32768.0;
+    double err = goal - (turns - floor(turns));
+    if (err > 0.5) {
+      err -= 1.0;
+    } else if (err < -0.5) {
+      err += 1.0;
+    }
+    target = err * 600.0;
+    if (target > 60) {
+      target = 60;
+    } else if (target < -60) {
+      target = -60;
+    }
+  } else {
+    // current / open loop: speed follows the command.
+    target = cmd / 32767.0 * limit;
+  }
+  if (target > limit) {
+    target = limit;
+  } else if (target < -limit) {
+    target = -limit;
+  }
+
+  // act: acceleration time per 1 rpm in 0.1ms, 0 -> 1.
+  double accel = 10000.0 / (act ? act : 1);
+  double dv = target - rpm;
+  double max_dv = accel * dt;
+  if (dv > max_dv) {
+    dv = max_dv;
+  } else if (dv < -max_dv) {
+    dv = -max_dv;
+  }
+  rpm += dv;
+  turns += rpm / 60.0 * dt;
+
+  // current from acceleration plus friction, 1st order thermal model.
+  double a = dt > 0 ? dv / dt : 0;
+  current = a * 0.5 + rpm * 20.0;
+  if (current > 32767) {
+    current = 32767;
+  } else if (current < -32767) {
+    current = -32767;
+  }
+  double heat = fabs(current) / 32767.0 * 40.0;
+  temperature += (25 + heat - temperature) * dt / 60.0;
+}
+
+// ddsm210: ID 0x64 SPEED[2] CURRENT[2] ACC_TIME TEMP ERROR CRC8
+// ddsm115: ID MODE TORQUE[2] SPEED[2] POSITION[2] ERROR CRC8
+void sim_motor::feedback(uint8_t *out) {
+  int16_t cur = (int16_t)current;
+  out[0] = id;
+  if (model == TYPE_DDSM210) {
+    int16_t spd = (int16_t)lround(rpm * 10.0);
+    out[1] = 0x64;
+    out[2] = (spd >> 8) & 0xFF;
+    out[3] = spd & 0xFF;
+    out[4] = (cur >> 8) & 0xFF;
+    out[5] = cur & 0xFF;
+    out[6] = act;
+    out[7] = (uint8_t)temperature;
+  } else {
+    int16_t spd = (int16_t)lround(rpm);
+    uint16_t pos = position();
+    out[1] = mode;
+    out[2] = (cur >> 8) & 0xFF;
+    out[3] = cur & 0xFF;
+    out[4] = (spd >> 8) & 0xFF;
+    out[5] = spd & 0xFF;
+    out[6] = (pos >> 8) & 0xFF;
+    out[7] = pos & 0xFF;
+  }
+  out[8] = fault;
+  out[9] = crc8_frame(out, 9);
+}
+
+// ddsm210: ID 0x74 MILEAGE[4] POSITION[2] ERROR CRC8
+// ddsm115: ID MODE TORQUE[2] SPEED[2] TEMP U8 ERROR CRC8
+void sim_motor::info(uint8_t *out) {
+  out[0] = id;
+  if (model == TYPE_DDSM210) {
+    int32_t mileage = (int32_t)floor(turns);
+    uint16_t pos = position();
+    out[1] = 0x74;
+    out[2] = ((uint32_t)mileage >> 24) & 0xFF;
+    out[3] = ((uint32_t)mileage >> 16) & 0xFF;
+    out[4] = ((uint32_t)mileage >> 8) & 0xFF;
+    out[5] = (uint32_t)mileage & 0xFF;
+    out[6] = (pos >> 8) & 0xFF;
+    out[7] = pos & 0xFF;
+  } else {
+    int16_t cur = (int16_t)current;
+    int16_t spd = (int16_t)lround(rpm);
+    out[1] = mode;
+    out[2] = (cur >> 8) & 0xFF;
+    out[3] = cur & 0xFF;
+    out[4] = (spd >> 8) & 0xFF;
+    out[5] = spd & 0xFF;
+    out[6] = (uint8_t)temperature;
+    out[7] = 0;
+  }
+  out[8] = fault;
+  out[9] = crc8_frame(out, 9);
+}
@@ -0,0 +1,46 @@
+#ifndef _SIM_MOTOR_H
+#define _SIM_MOTOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TYPE_DDSM115
+#define TYPE_DDSM115  1
+#define TYPE_DDSM210  2
+#endif
+
+// one simulated DDSM115 / DDSM210.
+// modes follow the motors: 115: 1 current, 2 speed, 3 position;
+// 210: 0 open loop, 2 speed, 3 position.
+// position is 0 ~ 32767 per revolution, the 210 mileage counts whole
+// revolutions (signed).
+struct sim_motor {
+	uint8_t id;
+	uint8_t model;
+	uint8_t mode;
+	int cmd;
+	uint8_t act;
+	double rpm;        // actual speed
+	double turns;      // revolutions since power on
+	double current;    // -32767 ~ 32767 -> -8 ~ 8 A
+	double temperature;
+	uint8_t fault;
+	bool id_changed;   // the id can change once per power cycle
+
+	void init(uint8_t motor_id, uint8_t motor_model);
+
+	// advance the dynamics by dt seconds.
+	void step(double dt);
+
+	// apply a ctrl frame (0x64).
+	void ctrl(int command, uint8_t acc_time);
+
+	// reply frames, crc included.
+	void feedback(uint8_t *out);  // reply to 0x64 / 0xC8
+	void info(uint8_t *out);      // reply to 0x74
+
+	uint16_t position();
+	double max_rpm();
+};
+
+#endif
@@ -1,12 +1,34 @@
 #include <nvs_flash.h>
 #include <esp_system.h>
+#include <esp_timer.h>
+#include <atomic>
 #include <LittleFS.h>
 #include <WiFi.h>
 #include <WebServer.h>
 
 #include <ArduinoJson.h>
-StaticJsonDocument<256> jsonCmdReceive;
+
+// the motor bus engine (DDSM_CTRL) with its frame encoders, decoder,
+// link counters, round trip timing, odometry and estimator, the binary
+// setpoint parser and the feedback records: the ddsm_ctrl library.
+#include <ddsm_bincmd.h>
+#include <ddsm_ctrl.h>
+#include <ddsm_record.h>
+
+// big enough for a CMD_DDSM_BATCH of DDSM_BURST_MAX commands.
+StaticJsonDocument<1024> jsonCmdReceive;
 StaticJsonDocument<256> jsonInfoSend;
+// motor feedback printed by the bus task, apart from jsonInfoSend.
+StaticJsonDocument<256> jsonFbSend;
+
+// JSON command line from Serial, parsed in place: the strings of
+// jsonCmdReceive point into it until the next line.
+#define SERIAL_LINE_MAX 512
+char serial_line[SERIAL_LINE_MAX];
+size_t serial_line_len = 0;
+bool serial_line_overflow = false;
+// lines dropped because they didn't fit, in the CMD_DDSM_HEALTH bus line.
+uint32_t serial_overflows = 0;
 
 int InfoPrint = 1;
 
@@ -15,59 +37,161 @@ int InfoPrint = 1;
 #define DDSM_TX 19
 
 #define SERIAL_BAUDRATE 115200
+// feedback waits here while Serial sends, the bus task never does.
+#define SERIAL_TX_BUFFER 2048
 #define DDSM_BAUDRATE 115200
 
-#define TIME_BETWEEN_CMD 4
-
 #define TYPE_DDSM115  1
 #define TYPE_DDSM210  2
 
-const size_t packet_length = 10;     
-uint8_t packet_move[packet_length] = {0x01, 0x64, 0xff, 0xce, 0x00, 0x00, 0x00, 0x00, 0x00, 0xda};
+// max motors in one CMD_DDSM_CTRL_BURST.
+#define DDSM_BURST_MAX 8
+
+// ids scanned for motors at boot.
+#define DDSM_SCAN_FIRST 1
+#define DDSM_SCAN_LAST  32
+
+// the motor bus. requests wait in its transaction queue, oldest first:
+// the bus is half duplex and a motor answers right after its frame, so
+// the next one goes out once the reply before it is in or timed out.
+// every request completes in ddsm_done() (uart_ctrl.h).
+// only the bus task touches it.
+DDSM_CTRL ddsm;
+
+// link counters per motor id, dumped with CMD_DDSM_HEALTH.
+DDSM_HEALTH &ddsm_health = ddsm.health;
+
+// reply timeouts from the measured round trip times,
+// limits set with CMD_DDSM_TIMEOUT.
+DDSM_RTT &ddsm_rtt = ddsm.rtt;
+
+// requests that report together once each one is answered or given up
+// (ddsm_settle in uart_ctrl.h), the callback arg of a request.
+#define DDSM_GROUP_NONE 0
+#define DDSM_GROUP_STOP 1   // heartbeat stops
+#define DDSM_GROUP_BATCH 2  // CMD_DDSM_BATCH
+#define DDSM_GROUP_DRIVE 3  // CMD_DDSM_DRIVE
+#define DDSM_GROUP_ARG(group) ((void *)(uintptr_t)(group))
+
+// requests dropped unsent: the queue was full, or the heartbeat ran out.
+uint32_t ddsm_txn_dropped = 0;
+
+// the frames of a CMD_DDSM_BATCH or CMD_DDSM_DRIVE. the JSON command
+// waits for its feedback line holding cmd_lock, so there's one at a time.
+struct ddsm_group_state {
+  int ctrl;                // setpoints queued
+  int info;                // info queries queued
+  int ctrl_ok;             // setpoints answered
+  int info_ok;             // info queries answered
+  int settled;             // answered or given up
+  unsigned long first_at;  // micros(), first frame on the wire
+  unsigned long last_at;   // micros(), last frame on the wire
+  TaskHandle_t waiter;     // notified after the feedback line
+};
+ddsm_group_state ddsm_group;
+
+// resend a lost ctrl/info reply up to this many times, set with CMD_DDSM_RETRY.
+int ddsm_retry_limit = 0;
 
 // -1: off
 // 2000: ddsm stops when there is no new cmd received in the past 2000ms.
 int heartbeat_time_ms = -1;
-unsigned long prev_time = millis();
+// the motors were stopped by the heartbeat since the last cmd.
 bool stop_flag = false;
+// one-shot timer, armed again by every cmd.
+esp_timer_handle_t heartbeat_timer;
+// bumped by every cmd, a stop that fired before it is stale.
+// fed from the serial, http and bus tasks: atomic increment.
+std::atomic<uint32_t> heartbeat_gen(0);
+// set by the timer: heartbeat_gen when it fired.
+volatile bool heartbeat_due = false;
+volatile uint32_t heartbeat_fired = 0;
+// the last heartbeat stop: frames sent, replies, gone unanswered, when.
+int heartbeat_stops = 0;
+int heartbeat_acked = 0;
+int heartbeat_missed = 0;
+unsigned long heartbeat_stop_at = 0;
+
+// retries of every heartbeat stop, whatever CMD_DDSM_RETRY says.
+#define HEARTBEAT_STOP_RETRIES 2
 
 // 115: ddsm 115
 // 210: ddsm 210
+// for the ids that are not in ddsm_models.
 uint8_t ddsm_type = TYPE_DDSM115;
-bool get_info_flag = false;
-
-
-// func to print the packet_move data as HEX.
-void print_packet(uint8_t *packet, size_t length) {
-  for (size_t i = 0; i < length; i++) {
-    if (i > 0) Serial.print(", ");
-    Serial.print("0x");
-    if (packet[i] < 0x10) Serial.print("0");
-    Serial.print(packet[i], HEX);
-  }
-  Serial.println();
-}
-
 
-// CRC-8/MAXIM
-uint8_t crc8_update(uint8_t crc, uint8_t data) {
-  uint8_t i;
-  crc = crc ^ data;
-  for (i = 0; i < 8; ++i) {
-    if (crc & 0x01) {
-      crc = (crc >> 1) ^ 0x8c;
-    } else {
-      crc >>= 1;
-    }
-  }
-  return crc;
-}
-
-
-// clear ddsm serial buffer
-void clear_ddsm_buffer() {
-  while (Serial1.available() > 0) {
-    Serial1.read();
+// model of every motor id, set with CMD_DDSM_MODEL or by the bus scan.
+DDSM_MODELS &ddsm_models = ddsm.models;
+
+// wheel travel and rover pose, fed by every reply with a position.
+// wheels and geometry set with CMD_DDSM_ODOM_CFG.
+DDSM_ODOMETRY &ddsm_odom = ddsm.odometry;
+
+// speed / position of every motor, extrapolated between replies,
+// read with CMD_DDSM_STATE.
+DDSM_ESTIMATOR &ddsm_est = ddsm.estimator;
+
+// motor replies as 16-byte records (ddsm_record.h) instead of JSON
+// lines, set with CMD_DDSM_FB_MODE.
+bool ddsm_fb_binary = false;
+
+// picks the binary setpoint frames (ddsm_bincmd.h) out of the
+// JSON command stream.
+DDSM_BINCMD_PARSER ddsm_bincmd;
+
+// --- tasks ---
+// the motor bus has a task of its own on the core without the wifi
+// stack, serial commands and http one each next to the wifi stack.
+// only the bus task touches Serial1 and the ddsm queue, the others
+// hand it their motor commands through bus_queue.
+// no logging task: feedback is printed where it comes up, fb_send()
+// never waits for Serial, a line that doesn't fit the tx buffer is
+// dropped and counted (txd).
+#define BUS_TASK_CORE 1
+#define BUS_TASK_PRIO 3
+#define SERIAL_TASK_CORE 0
+#define SERIAL_TASK_PRIO 2
+#define HTTP_TASK_CORE 0
+#define HTTP_TASK_PRIO 1
+#define BUS_QUEUE_LENGTH 16
+
+// work for the bus task.
+#define BUS_JOB_JSON 0  // run jsonCmdReceive
+#define BUS_JOB_CTRL 1  // setpoints in cmds
+#define BUS_JOB_STOP 2  // the heartbeat ran out (heartbeat_due)
+#define BUS_JOB_RX 3    // Serial1 has data, wake up
+struct bus_job {
+  uint8_t kind;
+  uint8_t count;
+  ddsm_cmd cmds[DDSM_BINCMD_MAX];
+  TaskHandle_t done;              // BUS_JOB_JSON: notified when it ran
+};
+QueueHandle_t bus_queue;
+// the task waiting for the BUS_JOB_JSON that runs, a command that
+// answers later takes it (and sets it to NULL).
+TaskHandle_t bus_json_waiter = NULL;
+
+// one JSON command at a time, jsonCmdReceive and jsonInfoSend belong
+// to whoever holds it.
+SemaphoreHandle_t cmd_lock;
+
+// feedback lines dropped because the Serial tx buffer was full.
+uint32_t serial_tx_dropped = 0;
+// binary setpoint frames dropped because bus_queue was full.
+uint32_t bus_queue_dropped = 0;
+
+
+// uart_ctrl.h
+void ddsm_done(DDSM_CTRL *dc, int handle, int status, void *arg);
+
+
+// room for one more request: a full queue drops the oldest request not
+// on the wire yet, a newer setpoint makes it stale anyway. every request
+// has ddsm_done() as callback, so its slot is free once it's over and
+// the begin_*() after this always finds one.
+void ddsm_make_room() {
+  if (ddsm.txn_pending() >= DDSM_TXN_QUEUE) {
+    ddsm_txn_dropped += ddsm.cancel_queued(1);
   }
 }
 
@@ -85,58 +209,39 @@ void clear_ddsm_buffer() {
 //    wherever the mode is set to position mode
 //    the currently position is the 0 position and it moves to the goal position
 //    at the direction as the shortest path.
-void ddsm_ctrl(uint8_t id, int cmd, uint8_t act) {
-  packet_move[0] = id;
-  packet_move[1] = 0x64;
-
-  packet_move[2] = (cmd >> 8) & 0xFF;
-  packet_move[3] = cmd & 0xFF;
-
-  packet_move[4] = 0x00;
-  packet_move[5] = 0x00;
+void ddsm_ctrl(uint8_t id, int cmd, uint8_t act, uint8_t group = DDSM_GROUP_NONE) {
+  ddsm_make_room();
+  ddsm.begin_ctrl(id, cmd, act, ddsm_done, DDSM_GROUP_ARG(group));
+}
 
-  packet_move[6] = act;
-  packet_move[7] = 0x00;
 
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, packet_move[i]);
+// setpoints of several motors queued together, nothing else gets in
+// between. each frame still waits for the reply of the one before, a
+// motor answers right after its frame and the bus is half duplex: the
+// frames are queued and written one at a time, never as one block.
+void ddsm_ctrl_burst(const ddsm_cmd *cmds, int count, uint8_t group = DDSM_GROUP_NONE) {
+  if (count > DDSM_BURST_MAX) {
+    count = DDSM_BURST_MAX;
+  }
+  for (int i = 0; i < count; i++) {
+    ddsm_ctrl(cmds[i].id, cmds[i].cmd, cmds[i].act, group);
   }
-  packet_move[9] = crc;
-
-  Serial1.write(packet_move, packet_length);
 }
 
 
 // change ddsm id
 // make sure there is only one ddsm connected
+// the repeats of the id frame are queued like any request, each one
+// holds the bus for TIME_BETWEEN_CMD instead of a delay() on the bus
+// task. they need DDSM_CHANGE_ID_REPEAT slots: the oldest requests not
+// on the wire yet are dropped until they fit.
 void ddsm_change_id(uint8_t id) {
-  packet_move[0] = 0xAA;
-  
-  packet_move[1] = 0x55;
-  packet_move[2] = 0x53;
-  
-  packet_move[3] = id;
-  
-  packet_move[4] = 0x00;
-  packet_move[5] = 0x00;
-  packet_move[6] = 0x00;
-  packet_move[7] = 0x00;
-  packet_move[8] = 0x00;
-
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, packet_move[i]);
-  }
-  packet_move[9] = crc;
-
-  for (int i = 0;i < 5;i++) {
-    Serial1.write(packet_move, packet_length);
-    delay(TIME_BETWEEN_CMD);
+  while (ddsm.begin_change_id(id, ddsm_done, DDSM_GROUP_ARG(DDSM_GROUP_NONE)) < 0) {
+    if (ddsm.cancel_queued(1) == 0) {
+      return;
+    }
+    ddsm_txn_dropped++;
   }
-  print_packet(packet_move, packet_length);
 }
 
 
@@ -151,37 +256,10 @@ void ddsm_change_id(uint8_t id) {
 // 2 - speed loop
 // 3 - position loop
 
+// no reply, queued like any request.
 void ddsm_change_mode(uint8_t id, uint8_t mode) {
-  if (ddsm_type == TYPE_DDSM115) {
-    packet_move[0] = id;
-    packet_move[1] = 0xA0;
-    packet_move[2] = 0x00;
-    packet_move[3] = 0x00;
-    packet_move[4] = 0x00;
-    packet_move[5] = 0x00;
-    packet_move[6] = 0x00;
-    packet_move[7] = 0x00;
-    packet_move[8] = 0x00;
-    packet_move[9] = mode;
-  } else if (ddsm_type == TYPE_DDSM210) {
-    packet_move[0] = id;
-    packet_move[1] = 0xA0;
-    packet_move[2] = mode;
-    packet_move[3] = 0x00; 
-    packet_move[4] = 0x00;
-    packet_move[5] = 0x00;
-    packet_move[6] = 0x00;
-    packet_move[7] = 0x00;
-    packet_move[8] = 0x00;
-    // CRC-8/MAXIM
-    uint8_t crc = 0;
-    for (size_t i = 0; i < packet_length - 1; ++i) {
-      crc = crc8_update(crc, packet_move[i]);
-    }
-    packet_move[9] = crc;
-  }
-  Serial1.write(packet_move, packet_length);
-  print_packet(packet_move, packet_length);
+  ddsm_make_room();
+  ddsm.begin_change_mode(id, mode, ddsm_done, DDSM_GROUP_ARG(DDSM_GROUP_NONE));
 }
 
 
@@ -193,19 +271,8 @@ void ddsm_change_mode(uint8_t id, uint8_t mode) {
 // ddsm210 feedback:
 // 0  1    2        3        4       5       6          7          8     9
 void ddsm_id_check() {
-  packet_move[0] = 0xC8;
-  packet_move[1] = 0x64;
-  packet_move[2] = 0x00;
-  packet_move[3] = 0x00;
-
-  packet_move[4] = 0x00;
-  packet_move[5] = 0x00;
-  packet_move[6] = 0x00;
-  packet_move[7] = 0x00;
-
-  packet_move[8] = 0x00;
-  packet_move[9] = 0xDE;
-  Serial1.write(packet_move, packet_length);
+  ddsm_make_room();
+  ddsm.begin_id_check(ddsm_done, DDSM_GROUP_ARG(DDSM_GROUP_NONE));
 }
 
 
@@ -213,31 +280,71 @@ void ddsm_id_check() {
 // DDSM115 feedback:
 // 0  1    2        3        4       5       6    7  8     9 
 // ID MODE TORQUE_H TORQUE_L SPEED_H SPEED_L TEMP U8 ERROR CRC8
-void ddsm_get_info(uint8_t id) {  
-  packet_move[0] = id;
+void ddsm_get_info(uint8_t id, uint8_t group = DDSM_GROUP_NONE) {
+  ddsm_make_room();
+  ddsm.begin_get_info(id, ddsm_done, DDSM_GROUP_ARG(group));
+}
+
 
-  if (ddsm_type == TYPE_DDSM115) {
-    get_info_flag = true;
+// info queries of several motors queued together, each one sent when
+// the reply before it is in (or timed out).
+void ddsm_get_info_all(const uint8_t *ids, int count, uint8_t group = DDSM_GROUP_NONE) {
+  if (count > DDSM_BURST_MAX) {
+    count = DDSM_BURST_MAX;
+  }
+  for (int i = 0; i < count; i++) {
+    ddsm_get_info(ids[i], group);
   }
+}
 
-  packet_move[1] = 0x74;
 
-  packet_move[2] = 0x00;
-  packet_move[3] = 0x00;
+// {"T":10036,"id":[1,2,3,4]}
+// without "id": every motor in the model table (found by the bus scan).
+void ddsm_get_info_all_json() {
+  JsonArray list = jsonCmdReceive["id"];
+  uint8_t ids[DDSM_BURST_MAX];
+  int count = 0;
+  if (list.isNull()) {
+    for (int i = 0; i < ddsm_models.rows && count < DDSM_BURST_MAX; i++) {
+      ids[count++] = ddsm_models.row[i].id;
+    }
+  } else {
+    for (size_t i = 0; i < list.size() && count < DDSM_BURST_MAX; i++) {
+      ids[count++] = list[i];
+    }
+  }
+  ddsm_get_info_all(ids, count);
+}
 
-  packet_move[4] = 0x00;
-  packet_move[5] = 0x00;
-  packet_move[6] = 0x00;
-  packet_move[7] = 0x00;
 
-  packet_move[8] = 0x00;
-  // CRC-8/MAXIM
-  uint8_t crc = 0;
-  for (size_t i = 0; i < packet_length - 1; ++i) {
-    crc = crc8_update(crc, packet_move[i]);
+// {"T":10013,"id":[1,2,3,4],"cmd":[50,50,-50,-50],"act":3}
+// "act" is one value for all motors or an array like "id".
+void ddsm_ctrl_burst_json() {
+  JsonArray ids = jsonCmdReceive["id"];
+  JsonArray cmds = jsonCmdReceive["cmd"];
+  JsonVariant act = jsonCmdReceive["act"];
+  ddsm_cmd burst[DDSM_BURST_MAX];
+  int count = 0;
+  for (size_t i = 0; i < ids.size() && i < cmds.size() && count < DDSM_BURST_MAX; i++) {
+    burst[count].id = ids[i];
+    burst[count].cmd = cmds[i];
+    burst[count].act = act.is<JsonArray>() ? act[i].as<uint8_t>() : act.as<uint8_t>();
+    count++;
   }
-  packet_move[9] = crc;
-  Serial1.write(packet_move, packet_length);
+  ddsm_ctrl_burst(burst, count);
+}
+
+
+// setpoints of every odometry wheel (CMD_DDSM_ODOM_CFG) for the rover
+// velocity, v mm/s, w mrad/s, the motors in speed mode. each wheel is
+// limited to its model's speed, all of them by the same factor.
+// returns the wheels in burst.
+int ddsm_drive(int32_t v_mm_s, int32_t w_mrad_s, uint8_t act, ddsm_cmd *burst) {
+  int count = ddsm_odom.drive(v_mm_s, w_mrad_s, ddsm_models, ddsm_type, burst, DDSM_BURST_MAX);
+  for (int i = 0; i < count; i++) {
+    burst[i].act = act;
+  }
+  return count;
 }
 
 
@@ -247,41 +354,139 @@ void ddsm_stop(uint8_t id) {
 }
 
 
+// retries of a lost ctrl/info reply, 0: off.
+void set_ddsm_retry(int count) {
+  ddsm_retry_limit = count < 0 ? 0 : count;
+  ddsm.set_retries(ddsm_retry_limit);
+}
+
+
+// 1: motor replies as binary records, 0: as JSON lines.
+void set_ddsm_fb_mode(int binary) {
+  ddsm_fb_binary = binary != 0;
+}
+
+
+// limits of the adaptive reply timeout (us).
+void set_ddsm_timeout(uint32_t floor_us, uint32_t ceil_us) {
+  ddsm.set_timeout_limits(floor_us, ceil_us);
+}
+
+
+// model of one id: 115 or 210, 0 goes back to the CMD_TYPE one.
+void set_ddsm_model(uint8_t id, int inputType) {
+  if (inputType == 115) {
+    ddsm_models.set(id, TYPE_DDSM115);
+  } else if (inputType == 210) {
+    ddsm_models.set(id, TYPE_DDSM210);
+  } else if (inputType == 0) {
+    ddsm_models.set(id, 0);
+  }
+}
+
+
+// {"T":11006,"r":0.05,"track":0.3,"left":[1,3],"right":[2,4],"flip":[2,4]}
+// flip: wheels mounted mirrored, their forward is the motor's backwards.
+// the wheels and the pose start over.
+void ddsm_odom_cfg() {
+  JsonArray left = jsonCmdReceive["left"];
+  JsonArray right = jsonCmdReceive["right"];
+  JsonArray flip = jsonCmdReceive["flip"];
+  ddsm_odom.clear();
+  ddsm_odom.set_geometry(jsonCmdReceive["r"] | DDSM_ODOM_RADIUS, jsonCmdReceive["track"] | DDSM_ODOM_TRACK);
+  for (int side = DDSM_ODOM_LEFT; side <= DDSM_ODOM_RIGHT; side++) {
+    JsonArray ids = side == DDSM_ODOM_LEFT ? left : right;
+    for (size_t i = 0; i < ids.size(); i++) {
+      uint8_t id = ids[i];
+      int8_t dir = 1;
+      for (size_t k = 0; k < flip.size(); k++) {
+        if (flip[k].as<uint8_t>() == id) {
+          dir = -1;
+        }
+      }
+      ddsm_odom.add_wheel(id, side, dir);
+    }
+  }
+}
+
+
+// a cmd came in, the motors may go on for heartbeat_time_ms.
+void heartbeat_feed() {
+  heartbeat_gen.fetch_add(1);
+  stop_flag = false;
+  esp_timer_stop(heartbeat_timer);
+  if (heartbeat_time_ms >= 0) {
+    esp_timer_start_once(heartbeat_timer, (uint64_t)heartbeat_time_ms * 1000);
+  }
+}
+
+
 // set the heartbeat time.
 void set_heartbeat_time(int time_ms) {
   heartbeat_time_ms = time_ms;
+  heartbeat_feed();
 }
 
 
 // change ddsm type.
 void set_ddsm_type(int inputType) {
+  ddsm.set_ddsm_type(inputType);
   if (inputType == 115) {
     ddsm_type = TYPE_DDSM115;
-    Serial.println("DDSM115");
   } else if (inputType == 210) {
     ddsm_type = TYPE_DDSM210;
-    Serial.println("DDSM210");
   }
 }
 
-// heartbeat ctrl
-void heartbeat_ctrl() {
-  if (heartbeat_time_ms == -1) {
+// esp_timer task: no cmd for heartbeat_time_ms. the job wakes the bus
+// task ahead of everything queued, if the queue is full the bus task
+// still sees heartbeat_due within a tick.
+void heartbeat_expired(void *arg) {
+  heartbeat_fired = heartbeat_gen;
+  heartbeat_due = true;
+  bus_job job;
+  job.kind = BUS_JOB_STOP;
+  xQueueSendToFront(bus_queue, &job, 0);
+}
+
+
+// on the bus task: a stop frame to every known motor, one at a time
+// like any request, each in its own reply window and confirmed by its
+// reply (heartbeat_confirm). requests still waiting to go out are
+// older than the timeout, they'd hold the stops back and start the
+// motors again after them: dropped.
+// no motor known: ids 1 ~ 4, as before the bus scan.
+void heartbeat_stop() {
+  if (!heartbeat_due) {
+    return;
+  }
+  heartbeat_due = false;
+  if (heartbeat_fired != heartbeat_gen || stop_flag) {
     return;
   }
-  unsigned long curr_time = millis();
-  if (curr_time - prev_time > heartbeat_time_ms && !stop_flag) {
-    ddsm_stop(1);
-    delay(TIME_BETWEEN_CMD);
-    ddsm_stop(2);
-    delay(TIME_BETWEEN_CMD);
-    ddsm_stop(3);
-    delay(TIME_BETWEEN_CMD);
-    ddsm_stop(4);
-    delay(TIME_BETWEEN_CMD);
-    stop_flag = true;
-    Serial.println("Heartbeat Stop");
+  uint8_t stops[DDSM_BURST_MAX];
+  int count = 0;
+  for (int i = 0; i < ddsm_models.rows && count < DDSM_BURST_MAX; i++) {
+    stops[count] = ddsm_models.row[i].id;
+    count++;
+  }
+  if (count == 0) {
+    for (; count < 4; count++) {
+      stops[count] = count + 1;
+    }
   }
+  ddsm_txn_dropped += ddsm.cancel_queued();
+  stop_flag = true;
+  heartbeat_stops = count;
+  heartbeat_acked = 0;
+  heartbeat_missed = 0;
+  heartbeat_stop_at = micros();
+  // retries are taken when a request is queued.
+  ddsm.set_retries(HEARTBEAT_STOP_RETRIES);
+  for (int i = 0; i < count; i++) {
+    ddsm.begin_stop(stops[i], ddsm_done, DDSM_GROUP_ARG(DDSM_GROUP_STOP));
+  }
+  ddsm.set_retries(ddsm_retry_limit);
 }
 
 
@@ -301,7 +506,50 @@ void heartbeat_ctrl() {
 #include "http_server.h"
 
 
+// Serial1 callback (uart event task).
+void bus_wake() {
+  bus_job job;
+  job.kind = BUS_JOB_RX;
+  xQueueSend(bus_queue, &job, 0);
+}
+
+
+// motor bus: queued commands and feedback, waits at most a tick for
+// work or a reply in between.
+void bus_task(void *arg) {
+  bus_job job;
+  for (;;) {
+    if (xQueueReceive(bus_queue, &job, 1) == pdTRUE) {
+      bus_run(job);
+      while (xQueueReceive(bus_queue, &job, 0) == pdTRUE) {
+        bus_run(job);
+      }
+    }
+    heartbeat_stop();
+    ddsm.poll();
+  }
+}
+
+
+void serial_task(void *arg) {
+  for (;;) {
+    serialCtrl();
+    vTaskDelay(1);
+  }
+}
+
+
+// a slow http client only holds up this task.
+void http_task(void *arg) {
+  for (;;) {
+    server.handleClient();
+    vTaskDelay(1);
+  }
+}
+
+
 void setup() {
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER);
   Serial.begin(SERIAL_BAUDRATE);
   Serial1.begin(DDSM_BAUDRATE, SERIAL_8N1, DDSM_RX, DDSM_TX);
   
@@ -309,26 +557,34 @@ void setup() {
   initFS();
 
   // clear ddsm buffer.
-  clear_ddsm_buffer();
+  ddsm.pSerial = &Serial1;
+  ddsm.clear_ddsm_buffer();
+
+  // find the motors on the bus.
+  ddsm_discover(DDSM_SCAN_FIRST, DDSM_SCAN_LAST);
   
   // wifi init.
   initWifi();
 
   // http & web init.
   initHttpWebServer();
+
+  esp_timer_create_args_t heartbeat_args = {};
+  heartbeat_args.callback = heartbeat_expired;
+  heartbeat_args.name = "heartbeat";
+  esp_timer_create(&heartbeat_args, &heartbeat_timer);
+  cmd_lock = xSemaphoreCreateMutex();
+  bus_queue = xQueueCreate(BUS_QUEUE_LENGTH, sizeof(bus_job));
+  // a reply coming in wakes the bus task, the next frame goes out
+  // right after it instead of a tick later.
+  Serial1.onReceive(bus_wake);
+  xTaskCreatePinnedToCore(bus_task, "ddsm_bus", 6144, nullptr, BUS_TASK_PRIO, nullptr, BUS_TASK_CORE);
+  xTaskCreatePinnedToCore(serial_task, "serial_cmd", 8192, nullptr, SERIAL_TASK_PRIO, nullptr, SERIAL_TASK_CORE);
+  xTaskCreatePinnedToCore(http_task, "http", 8192, nullptr, HTTP_TASK_PRIO, nullptr, HTTP_TASK_CORE);
 }
 
 
+// everything runs in its own task (bus_task, serial_task, http_task).
 void loop() {
-  // heartbeat function.
-  heartbeat_ctrl();
-
-  // recving data from ddsm.
-  ddsm_fb();
-
-  // recving the json cmd from uart.
-  serialCtrl();
-
-  // recving the json cmd form http requests.
-  server.handleClient();
+  vTaskDelete(NULL);
 }
\ No newline at end of file
@@ -14,13 +14,18 @@ void webCtrlServer(){
 
   server.on("/js", [](){
     String jsonCmdWebString = server.arg(0);
-    deserializeJson(jsonCmdReceive, jsonCmdWebString);
-    jsonCmdReceiveHandler();
+    xSemaphoreTake(cmd_lock, portMAX_DELAY);
+    // a cmd from the web page feeds the heartbeat as one from serial.
+    if (deserializeJson(jsonCmdReceive, jsonCmdWebString) == DeserializationError::Ok) {
+      heartbeat_feed();
+      jsonCmdRun();
+    }
     serializeJson(jsonInfoSend, jsonCmdWebString);
-    server.send(200, "text/plane", jsonCmdWebString);
-    jsonCmdWebString = "";
     jsonInfoSend.clear();
     jsonCmdReceive.clear();
+    xSemaphoreGive(cmd_lock);
+    server.send(200, "text/plane", jsonCmdWebString);
+    jsonCmdWebString = "";
   });
 
   // Start server
@@ -1,5 +1,12 @@
 #define FB_MOTOR 20010
 #define FB_INFO	 20011
+#define FB_HEALTH 20012
+#define FB_DISCOVER 20013
+#define FB_ODOM 20014
+#define FB_STATE 20015
+#define FB_HEARTBEAT 20016
+#define FB_BATCH 20017
+#define FB_DRIVE 20018
 
 // {"T":10000,"id":1}
 // ddsm_stop(id)
@@ -9,6 +16,34 @@
 // ddsm_ctrl(id, cmd, act)
 #define CMD_DDSM_CTRL 10010
 
+// {"T":10013,"id":[1,2,3,4],"cmd":[50,50,-50,-50],"act":3}
+// ctrl frames of several motors queued together, each one sent
+// when the reply to the one before is in (half duplex bus).
+// ddsm_ctrl_burst(cmds, count)
+#define CMD_DDSM_CTRL_BURST 10013
+
+// drive the rover: v mm/s forward, w mrad/s counter clockwise.
+// the speed of every wheel of CMD_DDSM_ODOM_CFG comes from its side,
+// the radius and track, flipped wheels turn the other way, all slowed
+// down together when one is over its model's limit. the wheel frames
+// are queued together, paced like any request. the motors have to be
+// in speed mode. one FB_DRIVE line once all are answered: the wheels,
+// the ones that answered and us from the first frame to the last.
+// {"T":10014,"v":500,"w":0,"act":3}
+// ddsm_drive_json()
+#define CMD_DDSM_DRIVE 10014
+
+// several ctrl (10010) / stop (10000) / info (10032) commands at once,
+// also as a plain JSON array of them. all checked first, then the
+// setpoints and the info queries are queued together, paced like any
+// request. at most 8 commands. one FB_BATCH line once all are answered
+// or given up, with the frames sent and answered, or "ok":0 and the
+// index of the first bad command, nothing sent.
+// {"T":10100,"cmds":[{"T":10010,"id":1,"cmd":50,"act":3},{"T":10010,"id":2,"cmd":-50,"act":3}]}
+// [{"T":10010,"id":1,"cmd":50,"act":3},{"T":10000,"id":2}]
+// ddsm_batch_json()
+#define CMD_DDSM_BATCH 10100
+
 // {"T":10011,"id":2}
 // ddsm_change_id(id)
 #define CMD_DDSM_CHANGE_ID	10011
@@ -38,6 +73,49 @@
 // ddsm_get_info(id)
 #define CMD_DDSM_INFO	10032
 
+// info of several motors with one command: the queries are queued
+// together and go out one reply apart, every reply is printed as for
+// CMD_DDSM_INFO.
+// without "id" every motor found by the bus scan is asked.
+// {"T":10036,"id":[1,2,3,4]}
+// ddsm_get_info_all(ids, count)
+#define CMD_DDSM_INFO_ALL	10036
+
+// probe ids first..last (default 1..32) for motors, one at a time with
+// a short gap for absent ids:
+// one FB_DISCOVER line per motor with its model, then one with the
+// number found. also done at boot.
+// {"T":10034,"first":1,"last":32}
+// ddsm_discover(first, last)
+#define CMD_DDSM_DISCOVER	10034
+
+// link counters of every motor, one FB_HEALTH line per id and one
+// for the whole bus (id 0). "clear":1 resets them after the dump.
+// {"T":10033}
+// {"T":10033,"clear":1}
+// ddsm_health_fb(clear)
+#define CMD_DDSM_HEALTH	10033
+
+// rover pose from the wheel odometry, "reset":1 sets it back to 0
+// after the reply. one FB_ODOM line:
+// x, y (m), th: heading (rad, ccw), d: distance travelled (m),
+// n: pose steps so far.
+// {"T":10035}
+// {"T":10035,"reset":1}
+// ddsm_odom_fb(reset)
+#define CMD_DDSM_ODOM	10035
+
+// speed, acceleration and position of a motor estimated from its
+// replies, dt ms ahead of now (default 0), without bus traffic.
+// sd / psd: 1 sigma of speed (rpm) / position (counts),
+// age: us since the motor's last reply. without "id" (or 0): all motors.
+// {"T":10037,"id":1}
+// {"T":10037,"id":1,"dt":20}
+// ddsm_state_fb(id, dt)
+#define CMD_DDSM_STATE	10037
+
+// stop every known motor when no cmd came in for time ms,
+// confirmed with one FB_HEARTBEAT line.
 // {"T":11001,"time":2000}
 // {"T":11001,"time":-1}
 // set_heartbeat_time(time_ms)
@@ -50,6 +128,43 @@
 // set_ddsm_type(type)
 #define CMD_TYPE	11002
 
+// resend a ctrl/info request whose reply timed out or failed the CRC,
+// at most retry times. 0: off [default]
+// {"T":11003,"retry":1}
+// set_ddsm_retry(retry)
+#define CMD_DDSM_RETRY	11003
+
+// the reply timeout follows the measured round trip time of every
+// motor, kept within floor..ceil (us).
+// {"T":11004,"floor":2000,"ceil":10000}
+// set_ddsm_timeout(floor, ceil)
+#define CMD_DDSM_TIMEOUT	11004
+
+// model of one motor id, so ddsm115s and ddsm210s can share the bus.
+// frames to and from that id use it, other ids use CMD_TYPE.
+// the bus scan (CMD_DDSM_DISCOVER) sets it for every motor found.
+//		115 / 210
+//		0 - back to the CMD_TYPE one
+// {"T":11005,"id":3,"type":115}
+// set_ddsm_model(id, type)
+#define CMD_DDSM_MODEL	11005
+
+// wheels of the odometry: r: wheel radius (m), track: distance between
+// the left and right wheels (m), flip: wheels mounted mirrored.
+// every reply with a position moves the pose (ddsm115: all replies,
+// ddsm210: info replies). wheels and pose start over.
+// {"T":11006,"r":0.05,"track":0.3,"left":[1,3],"right":[2,4],"flip":[2,4]}
+// ddsm_odom_cfg()
+#define CMD_DDSM_ODOM_CFG	11006
+
+// how motor replies (FB_MOTOR / FB_INFO) are sent:
+//		0 - JSON lines [default]
+//		1 - 16-byte binary records, see ddsm_record.h
+// the other feedback stays JSON.
+// {"T":11007,"bin":1}
+// set_ddsm_fb_mode(bin)
+#define CMD_DDSM_FB_MODE	11007
+
 
 // === === === wifi settings. === === ===
 
@@ -1,5 +1,174 @@
+// defined further down.
+void ddsm_health_fb(bool clear);
+void ddsm_discover(int first, int last);
+void ddsm_odom_fb(bool reset);
+void ddsm_state_fb(int id, int ahead_ms);
+void bus_fb_send();
+
+// CMD_DDSM_BATCH: ctrl / stop / info commands of several motors from one
+// JSON document, all checked before anything is sent. the setpoints are
+// queued first, then the info queries, nothing else gets in between:
+// each frame goes out once the one before is answered (or given up).
+// one FB_BATCH line once all of them are settled, with the frames
+// queued and the ones a motor answered, also the /js reply:
+// {"T":20017,"ok":1,"ctrl":4,"info":1,"ctrl_ok":4,"info_ok":1,"us":10400}
+// or, nothing sent, the index of the first bad command:
+// {"T":20017,"ok":0,"at":2}
+void ddsm_batch_json() {
+  JsonArray list = jsonCmdReceive.is<JsonArray>() ? jsonCmdReceive.as<JsonArray>()
+                                                  : jsonCmdReceive["cmds"].as<JsonArray>();
+  ddsm_cmd burst[DDSM_BURST_MAX];
+  uint8_t info[DDSM_BURST_MAX];
+  int count = 0;
+  int infos = 0;
+  int at = 0;
+  bool ok = !list.isNull() && list.size() > 0;
+  for (JsonObject c : list) {
+    int cmdType = c["T"] | -1;
+    int id = c["id"] | -1;
+    // every frame of the batch has a slot in the request table.
+    if (id < 0 || id > 253 || count + infos >= DDSM_BURST_MAX) {
+      ok = false;
+    } else if (cmdType == CMD_DDSM_CTRL) {
+      burst[count].id = id;
+      burst[count].cmd = c["cmd"];
+      burst[count].act = c["act"];
+      count++;
+    } else if (cmdType == CMD_DDSM_STOP) {
+      burst[count].id = id;
+      burst[count].cmd = 0;
+      burst[count].act = 0;
+      count++;
+    } else if (cmdType == CMD_DDSM_INFO) {
+      info[infos++] = id;
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      break;
+    }
+    at++;
+  }
+
+  if (!ok) {
+    jsonFbSend.clear();
+    jsonFbSend["T"] = FB_BATCH;
+    jsonFbSend["ok"] = 0;
+    jsonFbSend["at"] = at;
+    bus_fb_send();
+    // and the reply of a /js request.
+    jsonInfoSend.set(jsonFbSend);
+    return;
+  }
+  memset(&ddsm_group, 0, sizeof(ddsm_group));
+  ddsm_group.ctrl = count;
+  ddsm_group.info = infos;
+  ddsm_group.first_at = micros();
+  // answered by ddsm_batch_confirm().
+  ddsm_group.waiter = bus_json_waiter;
+  bus_json_waiter = NULL;
+  ddsm_ctrl_burst(burst, count, DDSM_GROUP_BATCH);
+  ddsm_get_info_all(info, infos, DDSM_GROUP_BATCH);
+}
+
+
+// the feedback line of a batch or drive is out, the JSON command that
+// waits for it can go on.
+void ddsm_group_done() {
+  jsonInfoSend.set(jsonFbSend);
+  if (ddsm_group.waiter) {
+    xTaskNotifyGive(ddsm_group.waiter);
+    ddsm_group.waiter = NULL;
+  }
+}
+
+
+// a frame of the batch is settled, FB_BATCH after the last one.
+void ddsm_batch_confirm(const ddsm_txn &t, bool ok) {
+  if (ok && t.info) {
+    ddsm_group.info_ok++;
+  } else if (ok) {
+    ddsm_group.ctrl_ok++;
+  }
+  if (++ddsm_group.settled < ddsm_group.ctrl + ddsm_group.info) {
+    return;
+  }
+  jsonFbSend.clear();
+  jsonFbSend["T"] = FB_BATCH;
+  jsonFbSend["ok"] = 1;
+  jsonFbSend["ctrl"] = ddsm_group.ctrl;
+  jsonFbSend["info"] = ddsm_group.info;
+  jsonFbSend["ctrl_ok"] = ddsm_group.ctrl_ok;
+  jsonFbSend["info_ok"] = ddsm_group.info_ok;
+  jsonFbSend["us"] = micros() - ddsm_group.first_at;
+  bus_fb_send();
+  ddsm_group_done();
+}
+
+// FB_DRIVE once every wheel of the drive is settled.
+void ddsm_drive_fb() {
+  jsonFbSend.clear();
+  jsonFbSend["T"] = FB_DRIVE;
+  jsonFbSend["n"] = ddsm_group.ctrl;
+  jsonFbSend["ok"] = ddsm_group.ctrl_ok;
+  jsonFbSend["skew"] = ddsm_group.first_at ? ddsm_group.last_at - ddsm_group.first_at + DDSM_FRAME_US : 0;
+  bus_fb_send();
+  ddsm_group_done();
+}
+
+
+// a wheel frame of the drive is settled. a frame is timed when it is
+// written, the bus is idle then, so sent_at is when it starts.
+// sent: false for a frame dropped before it went out.
+void ddsm_drive_confirm(const ddsm_txn &t, bool ok, bool sent) {
+  if (ok) {
+    ddsm_group.ctrl_ok++;
+  }
+  if (sent) {
+    if (!ddsm_group.first_at) {
+      ddsm_group.first_at = t.sent_at;
+    }
+    ddsm_group.last_at = t.sent_at;
+  }
+  if (++ddsm_group.settled == ddsm_group.ctrl) {
+    ddsm_drive_fb();
+  }
+}
+
+
+// CMD_DDSM_DRIVE: {"T":10014,"v":500,"w":0,"act":3}
+// the wheel setpoints are queued together, each one goes out once the
+// one before is answered (or given up). one FB_DRIVE line after the
+// last one, also the /js reply: "ok" the wheels that answered, "skew"
+// (us) from the start of the first wheel frame to the end of the last
+// one on the wire.
+// {"T":20018,"n":4,"ok":4,"skew":7630}
+void ddsm_drive_json() {
+  ddsm_cmd burst[DDSM_BURST_MAX];
+  int count = ddsm_drive(jsonCmdReceive["v"] | 0, jsonCmdReceive["w"] | 0,
+                         jsonCmdReceive["act"] | 0, burst);
+  memset(&ddsm_group, 0, sizeof(ddsm_group));
+  ddsm_group.ctrl = count;
+  if (count == 0) {
+    ddsm_drive_fb();
+    return;
+  }
+  // answered by ddsm_drive_fb().
+  ddsm_group.waiter = bus_json_waiter;
+  bus_json_waiter = NULL;
+  ddsm_ctrl_burst(burst, count, DDSM_GROUP_DRIVE);
+}
+
+// T of the command in jsonCmdReceive, a JSON array is a CMD_DDSM_BATCH.
+int jsonCmdType() {
+  if (jsonCmdReceive.is<JsonArray>()) {
+    return CMD_DDSM_BATCH;
+  }
+  return jsonCmdReceive["T"].as<int>();
+}
+
 void jsonCmdReceiveHandler(){
-	int cmdType = jsonCmdReceive["T"].as<int>();
+	int cmdType = jsonCmdType();
 	switch(cmdType){
 	case CMD_DDSM_STOP:
                 ddsm_stop(
@@ -9,6 +178,12 @@ void jsonCmdReceiveHandler(){
 								jsonCmdReceive["id"],
 								jsonCmdReceive["cmd"],
 								jsonCmdReceive["act"]);break;
+  case CMD_DDSM_CTRL_BURST:
+                ddsm_ctrl_burst_json();break;
+  case CMD_DDSM_BATCH:
+                ddsm_batch_json();break;
+  case CMD_DDSM_DRIVE:
+                ddsm_drive_json();break;
   case CMD_DDSM_CHANGE_ID:
                 ddsm_change_id(
                 jsonCmdReceive["id"]);break;
@@ -21,12 +196,44 @@ void jsonCmdReceiveHandler(){
   case CMD_DDSM_INFO:
                 ddsm_get_info(
                 jsonCmdReceive["id"]);break;
+  case CMD_DDSM_INFO_ALL:
+                ddsm_get_info_all_json();break;
 	case CMD_HEARTBEAT_TIME:
                 set_heartbeat_time(
 								jsonCmdReceive["time"]);break;
+  case CMD_DDSM_DISCOVER:
+                ddsm_discover(
+                jsonCmdReceive["first"] | DDSM_SCAN_FIRST,
+                jsonCmdReceive["last"] | DDSM_SCAN_LAST);break;
+  case CMD_DDSM_ODOM:
+                ddsm_odom_fb(
+                jsonCmdReceive["reset"] | 0);break;
+  case CMD_DDSM_STATE:
+                ddsm_state_fb(
+                jsonCmdReceive["id"] | 0,
+                jsonCmdReceive["dt"] | 0);break;
+  case CMD_DDSM_HEALTH:
+                ddsm_health_fb(
+                jsonCmdReceive["clear"] | 0);break;
   case CMD_TYPE:
                 set_ddsm_type(
                 jsonCmdReceive["type"]);break;
+  case CMD_DDSM_RETRY:
+                set_ddsm_retry(
+                jsonCmdReceive["retry"]);break;
+  case CMD_DDSM_TIMEOUT:
+                set_ddsm_timeout(
+                jsonCmdReceive["floor"] | DDSM_RTT_FLOOR_US,
+                jsonCmdReceive["ceil"] | DDSM_RTT_CEIL_US);break;
+  case CMD_DDSM_MODEL:
+                set_ddsm_model(
+                jsonCmdReceive["id"],
+                jsonCmdReceive["type"]);break;
+  case CMD_DDSM_ODOM_CFG:
+                ddsm_odom_cfg();break;
+  case CMD_DDSM_FB_MODE:
+                set_ddsm_fb_mode(
+                jsonCmdReceive["bin"] | 0);break;
 
 
   // === === === wifi settings. === === ===
@@ -76,188 +283,463 @@ void jsonCmdReceiveHandler(){
 	}
 }
 
+// commands that talk to the motors or change the bus state run on the
+// bus task. CMD_DDSM_STATE only reads the estimator (seqlock), so it
+// is answered right away from any task.
+bool cmd_on_bus(int cmdType) {
+  if (cmdType == CMD_DDSM_STATE) {
+    return false;
+  }
+  return (cmdType >= 10000 && cmdType < 10400) || (cmdType >= 11000 && cmdType < 12000);
+}
+
+
+// run the command in jsonCmdReceive, cmd_lock held.
+// bus commands are handed to the bus task, and this waits until they ran.
+void jsonCmdRun() {
+  if (!cmd_on_bus(jsonCmdType())) {
+    jsonCmdReceiveHandler();
+    return;
+  }
+  bus_job job;
+  job.kind = BUS_JOB_JSON;
+  job.done = xTaskGetCurrentTaskHandle();
+  xQueueSend(bus_queue, &job, portMAX_DELAY);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+
+// a job from bus_queue, on the bus task.
+void bus_run(const bus_job &job) {
+  if (job.kind == BUS_JOB_JSON) {
+    bus_json_waiter = job.done;
+    jsonCmdReceiveHandler();
+    // unless the command answers later (ddsm_group_done).
+    if (bus_json_waiter) {
+      xTaskNotifyGive(bus_json_waiter);
+      bus_json_waiter = NULL;
+    }
+    return;
+  }
+  if (job.kind == BUS_JOB_STOP) {
+    heartbeat_stop();
+    return;
+  }
+  if (job.kind == BUS_JOB_RX) {
+    // ddsm.poll() after the queue is drained.
+    return;
+  }
+  if (job.count == 1) {
+    ddsm_ctrl(job.cmds[0].id, job.cmds[0].cmd, job.cmds[0].act);
+  } else {
+    ddsm_ctrl_burst(job.cmds, job.count);
+  }
+}
+
+
+// a binary setpoint frame goes to the bus task as it is, no waiting.
+// a full queue drops and counts it, the next setpoint replaces it anyway.
+void ddsm_bincmd_handler() {
+  bus_job job;
+  job.kind = BUS_JOB_CTRL;
+  job.count = ddsm_bincmd.cmds(job.cmds, DDSM_BINCMD_MAX);
+  if (job.count > 0) {
+    heartbeat_feed();
+    if (xQueueSend(bus_queue, &job, 0) != pdTRUE) {
+      bus_queue_dropped++;
+    }
+  }
+}
+
+// a complete JSON line in serial_line.
+void serialLine() {
+  xSemaphoreTake(cmd_lock, portMAX_DELAY);
+  // char * input: ArduinoJson parses in place, nothing is copied.
+  DeserializationError err = deserializeJson(jsonCmdReceive, serial_line, serial_line_len);
+  if (err == DeserializationError::Ok) {
+    heartbeat_feed();
+    jsonCmdRun();
+  }
+  xSemaphoreGive(cmd_lock);
+}
+
+// whatever Serial holds, read in chunks into a fixed line buffer,
+// no heap. a line longer than SERIAL_LINE_MAX is dropped and counted.
 void serialCtrl() {
-  static String receivedData;
-
-  while (Serial.available() > 0) {
-    char receivedChar = Serial.read();
-    receivedData += receivedChar;
-
-    // Detect the end of the JSON string based on a specific termination character
-    if (receivedChar == '\n') {
-      // Now we have received the complete JSON string
-      DeserializationError err = deserializeJson(jsonCmdReceive, receivedData);
-      if (err == DeserializationError::Ok) {
-      	prev_time = millis();
-      	if (stop_flag) {
-      		stop_flag = false;
-      	}
-      	clear_ddsm_buffer();
-        jsonCmdReceiveHandler();
+  uint8_t chunk[64];
+  int n;
+  while ((n = Serial.available()) > 0) {
+    n = Serial.readBytes(chunk, n < (int)sizeof(chunk) ? n : sizeof(chunk));
+    uint32_t now = micros();
+    for (int i = 0; i < n; i++) {
+      int parsed = ddsm_bincmd.feed(chunk[i], now);
+      if (parsed == DDSM_BINCMD_FRAME) {
+        ddsm_bincmd_handler();
+        continue;
+      }
+      if (parsed != DDSM_BINCMD_TEXT) {
+        continue;
+      }
+      if (chunk[i] == '\n') {
+        if (serial_line_overflow) {
+          serial_overflows++;
+        } else {
+          serial_line[serial_line_len] = 0;
+          serialLine();
+        }
+        serial_line_len = 0;
+        serial_line_overflow = false;
+      } else if (serial_line_len < SERIAL_LINE_MAX - 1) {
+        serial_line[serial_line_len++] = chunk[i];
       } else {
-        // Handle JSON parsing error here
+        serial_line_overflow = true;
       }
-      // Reset the receivedData for the next JSON string
-      receivedData = "";
     }
   }
 }
 
 
-void ddsm210_fb() {
-  if (Serial1.available() >= 10) {
-    uint8_t data[10];
-    Serial1.readBytes(data, 10);
+// a feedback line, dropped and counted instead of waiting when the
+// Serial tx buffer is full. no String, the line is built on the stack.
+void fb_send(const JsonDocument &doc) {
+  char line[256];
+  size_t n = serializeJson(doc, line, sizeof(line) - 2);
+  line[n++] = '\r';
+  line[n++] = '\n';
+  if ((size_t)Serial.availableForWrite() < n) {
+    serial_tx_dropped++;
+    return;
+  }
+  Serial.write((const uint8_t *)line, n);
+}
 
-    // CRC-8/MAXIM
-    uint8_t crc = 0;
-    for (size_t i = 0; i < packet_length - 1; ++i) {
-      crc = crc8_update(crc, data[i]);
-    }
-    if (crc != data[9]){
-      jsonInfoSend.clear();
-      jsonInfoSend["T"] = FB_MOTOR;
-      jsonInfoSend["crc"] = 0;
-      String getInfoJsonString;
-      serializeJson(jsonInfoSend, getInfoJsonString);
-      Serial.println(getInfoJsonString);
-      return;
-    }
+// the feedback line of the bus task.
+void bus_fb_send() {
+  fb_send(jsonFbSend);
+}
 
-    int feedback_type = data[1];
-    uint8_t ID = data[0];
 
-    if (feedback_type == 0x64) {
-      int speed_data = (data[2] << 8) | data[3];
-      if (speed_data & 0x8000) {
-        speed_data = -(0x10000 - speed_data);
-      }
+// send a crc error msg.
+// id: the motor whose reply was garbled, 0 if none was expected.
+void ddsm_crc_fb(uint8_t id) {
+  jsonFbSend.clear();
+  jsonFbSend["T"] = FB_MOTOR;
+  jsonFbSend["crc"] = 0;
+  if (id != 0) {
+    jsonFbSend["id"] = id;
+  }
+  bus_fb_send();
+}
 
-      int current = (data[4] << 8) | data[5];
-      if (current & 0x8000) {
-        current = -(0x10000 - current);
-      }
 
-      int acceleration_time = data[6];
-      int temperature = data[7];
-      int fault_code = data[8];
-
-      jsonInfoSend.clear();
-      jsonInfoSend["T"] = FB_MOTOR;
-      jsonInfoSend["id"]  = ID;
-      jsonInfoSend["typ"] = 210;
-      jsonInfoSend["spd"] = speed_data;
-      jsonInfoSend["crt"] = current;
-      jsonInfoSend["act"] = acceleration_time;
-      jsonInfoSend["tep"] = temperature;
-      jsonInfoSend["err"] = fault_code;
-      String getInfoJsonString;
-      serializeJson(jsonInfoSend, getInfoJsonString);
-      Serial.println(getInfoJsonString);
-    } else if (feedback_type == 0x74) {
-      int32_t mileage = (int32_t)((uint32_t)data[2] << 24 | (uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | (uint32_t)data[5]);
-      int ddsm_pos = (data[6] << 8) | data[7];
-      int fault_code = data[8];
-
-      jsonInfoSend.clear();
-      jsonInfoSend["T"] = FB_INFO;
-      jsonInfoSend["id"]  = ID;
-      jsonInfoSend["typ"] = 210;
-      jsonInfoSend["mil"] = mileage;
-      jsonInfoSend["pos"] = ddsm_pos;
-      jsonInfoSend["err"] = fault_code;
-      String getInfoJsonString;
-      serializeJson(jsonInfoSend, getInfoJsonString);
-      Serial.println(getInfoJsonString);
-    }
+// one line per motor and one for the whole bus (id 0).
+void ddsm_health_row_fb(const ddsm_health_row &row) {
+  jsonInfoSend.clear();
+  jsonInfoSend["T"] = FB_HEALTH;
+  jsonInfoSend["id"] = row.id;
+  jsonInfoSend["req"] = row.count[DDSM_HEALTH_REQUEST];
+  jsonInfoSend["rep"] = row.count[DDSM_HEALTH_REPLY];
+  jsonInfoSend["tmo"] = row.count[DDSM_HEALTH_TIMEOUT];
+  jsonInfoSend["crc"] = row.count[DDSM_HEALTH_CRC_ERR];
+  jsonInfoSend["sht"] = row.count[DDSM_HEALTH_SHORT];
+  jsonInfoSend["unx"] = row.count[DDSM_HEALTH_UNEXPECTED];
+  jsonInfoSend["rty"] = row.count[DDSM_HEALTH_RETRY];
+  // ctrl round trip (us), row.id 0 is the whole bus.
+  const ddsm_rtt_stats *rtt = row.id ? ddsm_rtt.stats(row.id, DDSM_RTT_CTRL) : &ddsm_rtt.bus[DDSM_RTT_CTRL];
+  if (rtt != nullptr && rtt->samples > 0) {
+    jsonInfoSend["rtt"] = (uint32_t)rtt->ewma_us;
+    jsonInfoSend["p99"] = (uint32_t)rtt->p99_us;
+  }
+  jsonInfoSend["to"] = ddsm_rtt.timeout(row.id, DDSM_RTT_CTRL);
+  if (row.id == 0) {
+    // command lines from Serial too long for the line buffer.
+    jsonInfoSend["ovf"] = serial_overflows;
+    // feedback lines that found the Serial tx buffer full.
+    jsonInfoSend["txd"] = serial_tx_dropped;
+    // requests dropped unsent: the bus couldn't keep up, or the heartbeat ran out.
+    jsonInfoSend["qdr"] = ddsm_txn_dropped;
+    // binary setpoints that found the bus task queue full.
+    jsonInfoSend["bqd"] = bus_queue_dropped;
+    // binary frames dropped half way, the link went idle.
+    jsonInfoSend["bst"] = ddsm_bincmd.stale;
   }
+  fb_send(jsonInfoSend);
 }
 
-void ddsm115_fb() {
-  if (Serial1.available() >= 10) {
-    uint8_t data[10];
-    Serial1.readBytes(data, 10);
+void ddsm_health_fb(bool clear) {
+  for (int i = 0; i < ddsm_health.rows; i++) {
+    ddsm_health_row_fb(ddsm_health.row[i]);
+  }
+  ddsm_health_row_fb(ddsm_health.total);
+  if (clear) {
+    ddsm_health.clear();
+    serial_overflows = 0;
+    serial_tx_dropped = 0;
+    ddsm_txn_dropped = 0;
+    bus_queue_dropped = 0;
+    ddsm_bincmd.stale = 0;
+  }
+}
 
-    uint8_t ddsm_id = data[0];
 
-    // CRC-8/MAXIM
-    uint8_t crc = 0;
-    for (size_t i = 0; i < packet_length - 1; ++i) {
-      crc = crc8_update(crc, data[i]);
-    }
-    if (crc != data[9]){
-      jsonInfoSend.clear();
-      jsonInfoSend["T"] = FB_MOTOR;
-      jsonInfoSend["crc"] = 0;
-      String getInfoJsonString;
-      serializeJson(jsonInfoSend, getInfoJsonString);
-      Serial.println(getInfoJsonString);
-      return;
-    }
+// the pose in one line.
+// {"T":20014,"x":1.204,"y":-0.031,"th":0.052,"d":1.21,"n":5120}
+void ddsm_odom_fb(bool reset) {
+  ddsm_pose pose;
+  ddsm_odom.pose(&pose);
+  jsonInfoSend.clear();
+  jsonInfoSend["T"] = FB_ODOM;
+  jsonInfoSend["x"] = pose.x;
+  jsonInfoSend["y"] = pose.y;
+  jsonInfoSend["th"] = pose.heading;
+  jsonInfoSend["d"] = pose.distance;
+  jsonInfoSend["n"] = pose.updates;
+  fb_send(jsonInfoSend);
+  if (reset) {
+    ddsm_odom.reset_pose(0, 0, 0);
+  }
+}
 
-    int ddsm_mode = data[1];
 
-    int ddsm_torque = (data[2] << 8) | data[3];
-    if (ddsm_torque & 0x8000) {
-      ddsm_torque = -(0x10000 - ddsm_torque);
-    }
+void ddsm_state_row_fb(uint8_t id, uint32_t at_us) {
+  ddsm_state s;
+  if (ddsm_est.state(id, at_us, &s) < 0) {
+    return;
+  }
+  jsonInfoSend.clear();
+  jsonInfoSend["T"] = FB_STATE;
+  jsonInfoSend["id"] = id;
+  jsonInfoSend["spd"] = s.speed;
+  jsonInfoSend["acc"] = s.accel;
+  jsonInfoSend["sd"] = s.speed_sd;
+  if (s.has_position) {
+    jsonInfoSend["pos"] = s.position;
+    jsonInfoSend["psd"] = s.position_sd;
+  }
+  jsonInfoSend["age"] = s.age_us;
+  fb_send(jsonInfoSend);
+}
+
+
+// estimated state dt ms from now, no bus traffic.
+// id 0: one FB_STATE line per motor seen.
+// {"T":20015,"id":1,"spd":101.3,"acc":-12.5,"sd":0.8,"pos":20311.4,"psd":3.1,"age":4210}
+void ddsm_state_fb(int id, int ahead_ms) {
+  uint32_t at = micros() + (int32_t)ahead_ms * 1000;
+  if (id > 0) {
+    ddsm_state_row_fb(id, at);
+    return;
+  }
+  for (int i = 0; i < ddsm_est.rows; i++) {
+    ddsm_state_row_fb(ddsm_est.row_id(i), at);
+  }
+}
+
+
+// a heartbeat stop got its reply (or not), one FB_HEARTBEAT line once
+// all of them are settled:
+// {"T":20016,"stop":4,"ok":4,"us":3650}
+void heartbeat_confirm(bool ok) {
+  if (ok) {
+    heartbeat_acked++;
+  } else {
+    heartbeat_missed++;
+  }
+  if (heartbeat_acked + heartbeat_missed < heartbeat_stops) {
+    return;
+  }
+  jsonFbSend.clear();
+  jsonFbSend["T"] = FB_HEARTBEAT;
+  jsonFbSend["stop"] = heartbeat_stops;
+  jsonFbSend["ok"] = heartbeat_acked;
+  jsonFbSend["us"] = micros() - heartbeat_stop_at;
+  bus_fb_send();
+}
+
+
+// request t got its reply (or never will): tell the group it is in.
+void ddsm_settle(uint8_t group, const ddsm_txn &t, int status) {
+  bool ok = status == DDSM_TXN_DONE;
+  switch (group) {
+  case DDSM_GROUP_STOP:
+    heartbeat_confirm(ok);
+    break;
+  case DDSM_GROUP_BATCH:
+    ddsm_batch_confirm(t, ok);
+    break;
+  case DDSM_GROUP_DRIVE:
+    ddsm_drive_confirm(t, ok, status != DDSM_TXN_DROPPED);
+    break;
+  }
+}
+
 
-    int ddsm_spd = (data[4] << 8) | data[5];
-    if (ddsm_spd & 0x8000) {
-      ddsm_spd = -(0x10000 - ddsm_spd);
+// probe ids first..last for motors, one after the other with a short
+// gap for absent ids (see ddsm_discover.h),
+// and print one FB_DISCOVER line per motor that answered and one with
+// the number found and the time the scan took.
+// {"T":20013,"id":1,"type":210,"rtt":2010}
+// {"T":20013,"found":4,"us":85500}
+void ddsm_discover(int first, int last) {
+  // the scan waits for the requests queued before it.
+  ddsm_motor found[DDSM_DISCOVER_MAX];
+  unsigned long start = micros();
+  int count = ddsm.discover(constrain(first, 1, 253), constrain(last, 0, 253),
+                            found, DDSM_DISCOVER_MAX);
+  unsigned long elapsed = micros() - start;
+
+  for (int i = 0; i < count; i++) {
+    jsonInfoSend.clear();
+    jsonInfoSend["T"] = FB_DISCOVER;
+    jsonInfoSend["id"] = found[i].id;
+    jsonInfoSend["type"] = found[i].model == TYPE_DDSM210 ? 210 : 115;
+    jsonInfoSend["rtt"] = found[i].rtt_us;
+    fb_send(jsonInfoSend);
+  }
+  jsonInfoSend.clear();
+  jsonInfoSend["T"] = FB_DISCOVER;
+  jsonInfoSend["found"] = count;
+  jsonInfoSend["us"] = elapsed;
+  fb_send(jsonInfoSend);
+}
+
+
+void ddsm210_fb(const uint8_t *data) {
+  int feedback_type = data[1];
+  uint8_t ID = data[0];
+
+  if (feedback_type == 0x64) {
+    int speed_data = (data[2] << 8) | data[3];
+    if (speed_data & 0x8000) {
+      speed_data = -(0x10000 - speed_data);
     }
 
-    if (get_info_flag) {
-      get_info_flag = false;
-      int ddsm_temp = data[6];
-      int ddsm_u8 = data[7];
-
-      int ddsm_error = data[8];
-
-      jsonInfoSend.clear();
-      jsonInfoSend["T"] = FB_MOTOR;
-      jsonInfoSend["id"] = ddsm_id;
-      jsonInfoSend["typ"] = 115;
-      jsonInfoSend["mode"] = ddsm_mode;
-      jsonInfoSend["tor"] = ddsm_torque;
-      jsonInfoSend["spd"] = ddsm_spd;
-      jsonInfoSend["temp"] = ddsm_temp;
-      jsonInfoSend["u8"] = ddsm_u8;
-      jsonInfoSend["err"] = ddsm_error;
-      String getInfoJsonString;
-      serializeJson(jsonInfoSend, getInfoJsonString);
-      Serial.println(getInfoJsonString);
-      print_packet(data, 10);
-    } else {
-      int ddsm_pos = (data[6] << 8) | data[7];
-      // if (ddsm_pos & 0x8000) {
-      //   ddsm_pos = -(0x10000 - ddsm_pos);
-      // }
-
-      int ddsm_error = data[8];
-
-      jsonInfoSend.clear();
-      jsonInfoSend["T"] = FB_MOTOR;
-      jsonInfoSend["id"] = ddsm_id;
-      jsonInfoSend["typ"] = 115;
-      jsonInfoSend["mode"] = ddsm_mode;
-      jsonInfoSend["tor"] = ddsm_torque;
-      jsonInfoSend["spd"] = ddsm_spd;
-      jsonInfoSend["pos"] = ddsm_pos;
-      jsonInfoSend["err"] = ddsm_error;
-      String getInfoJsonString;
-      serializeJson(jsonInfoSend, getInfoJsonString);
-      Serial.println(getInfoJsonString);
-      print_packet(data, 10);
+    int current = (data[4] << 8) | data[5];
+    if (current & 0x8000) {
+      current = -(0x10000 - current);
     }
+
+    int acceleration_time = data[6];
+    int temperature = data[7];
+    int fault_code = data[8];
+
+    jsonFbSend.clear();
+    jsonFbSend["T"] = FB_MOTOR;
+    jsonFbSend["id"]  = ID;
+    jsonFbSend["typ"] = 210;
+    jsonFbSend["spd"] = speed_data;
+    jsonFbSend["crt"] = current;
+    jsonFbSend["act"] = acceleration_time;
+    jsonFbSend["tep"] = temperature;
+    jsonFbSend["err"] = fault_code;
+    bus_fb_send();
+  } else if (feedback_type == 0x74) {
+    int32_t mileage = (int32_t)((uint32_t)data[2] << 24 | (uint32_t)data[3] << 16 | (uint32_t)data[4] << 8 | (uint32_t)data[5]);
+    int ddsm_pos = (data[6] << 8) | data[7];
+    int fault_code = data[8];
+
+    jsonFbSend.clear();
+    jsonFbSend["T"] = FB_INFO;
+    jsonFbSend["id"]  = ID;
+    jsonFbSend["typ"] = 210;
+    jsonFbSend["mil"] = mileage;
+    jsonFbSend["pos"] = ddsm_pos;
+    jsonFbSend["err"] = fault_code;
+    bus_fb_send();
+  }
+}
+
+// info: the reply to an info query (TEMP U8 instead of POSITION).
+void ddsm115_fb(const uint8_t *data, bool info) {
+  uint8_t ddsm_id = data[0];
+
+  int ddsm_mode = data[1];
+
+  int ddsm_torque = (data[2] << 8) | data[3];
+  if (ddsm_torque & 0x8000) {
+    ddsm_torque = -(0x10000 - ddsm_torque);
+  }
+
+  int ddsm_spd = (data[4] << 8) | data[5];
+  if (ddsm_spd & 0x8000) {
+    ddsm_spd = -(0x10000 - ddsm_spd);
+  }
+
+  if (info) {
+    int ddsm_temp = data[6];
+    int ddsm_u8 = data[7];
+
+    int ddsm_error = data[8];
+
+    jsonFbSend.clear();
+    jsonFbSend["T"] = FB_MOTOR;
+    jsonFbSend["id"] = ddsm_id;
+    jsonFbSend["typ"] = 115;
+    jsonFbSend["mode"] = ddsm_mode;
+    jsonFbSend["tor"] = ddsm_torque;
+    jsonFbSend["spd"] = ddsm_spd;
+    jsonFbSend["temp"] = ddsm_temp;
+    jsonFbSend["u8"] = ddsm_u8;
+    jsonFbSend["err"] = ddsm_error;
+    bus_fb_send();
+  } else {
+    int ddsm_pos = (data[6] << 8) | data[7];
+    // if (ddsm_pos & 0x8000) {
+    //   ddsm_pos = -(0x10000 - ddsm_pos);
+    // }
+
+    int ddsm_error = data[8];
+
+    jsonFbSend.clear();
+    jsonFbSend["T"] = FB_MOTOR;
+    jsonFbSend["id"] = ddsm_id;
+    jsonFbSend["typ"] = 115;
+    jsonFbSend["mode"] = ddsm_mode;
+    jsonFbSend["tor"] = ddsm_torque;
+    jsonFbSend["spd"] = ddsm_spd;
+    jsonFbSend["pos"] = ddsm_pos;
+    jsonFbSend["err"] = ddsm_error;
+    bus_fb_send();
+  }
+}
+
+
+// a reply as one binary record, no JSON document or String.
+void ddsm_record_fb(const uint8_t *data, uint8_t model, bool info) {
+  uint8_t record[DDSM_REC_LENGTH];
+  if (Serial.availableForWrite() < DDSM_REC_LENGTH) {
+    serial_tx_dropped++;
+    return;
+  }
+  Serial.write(record, ddsm_encode_record(record, data, model, info, micros()));
+}
+
+
+// the reply to a request, decoded with its motor's model.
+// info: the reply to an info query.
+void ddsm_reply_fb(const uint8_t *data, bool info) {
+  uint8_t model = ddsm.model_of(data[0]);
+  if (ddsm_fb_binary) {
+    ddsm_record_fb(data, model, info);
+  } else if (model == TYPE_DDSM115) {
+    ddsm115_fb(data, info);
+  } else {
+    ddsm210_fb(data);
   }
 }
 
 
-void ddsm_fb() {
-  if (ddsm_type == TYPE_DDSM115) {
-    ddsm115_fb();
-  } else if (ddsm_type == TYPE_DDSM210) {
-    ddsm210_fb();
+// a request is over: answered, given up, or dropped unsent. called on
+// the bus task from ddsm.poll() / cancel_queued(), arg: its group.
+// the replies are matched, decoded into the odometry and the estimator
+// and counted by the library, a frame that answers nothing is only
+// counted (DDSM_HEALTH_UNEXPECTED).
+void ddsm_done(DDSM_CTRL *dc, int handle, int status, void *arg) {
+  const ddsm_txn &t = *dc->txn_entry(handle);
+  if (status == DDSM_TXN_DONE && t.expect_reply) {
+    ddsm_reply_fb(t.reply, t.info);
+  } else if (status == DDSM_TXN_CRC_ERR) {
+    ddsm_crc_fb(t.id);
   }
-}
\ No newline at end of file
+  ddsm_settle((uint8_t)(uintptr_t)arg, t, status);
+}
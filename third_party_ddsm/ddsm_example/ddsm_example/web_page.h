@@ -357,6 +357,27 @@ const char index_html[] PROGMEM = R"rawliteral(
                                 </div>
                                 <button class="w-btn">INPUT</button>
                             </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_CTRL_BURST</p>
+                                    <p class="cmd-value">{"T":10013,"id":[1,2,3,4],"cmd":[50,50,-50,-50],"act":3}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_BATCH</p>
+                                    <p class="cmd-value">{"T":10100,"cmds":[{"T":10010,"id":1,"cmd":50,"act":3},{"T":10010,"id":2,"cmd":-50,"act":3}]}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_DRIVE</p>
+                                    <p class="cmd-value">{"T":10014,"v":500,"w":0,"act":3}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
                             <div class="info-box json-cmd-info">
                                 <div>
                                     <p>CMD_DDSM_CHANGE_ID</p>
@@ -385,6 +406,76 @@ const char index_html[] PROGMEM = R"rawliteral(
                                 </div>
                                 <button class="w-btn">INPUT</button>
                             </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_INFO_ALL</p>
+                                    <p class="cmd-value">{"T":10036,"id":[1,2,3,4]}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_DISCOVER</p>
+                                    <p class="cmd-value">{"T":10034,"first":1,"last":32}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_HEALTH</p>
+                                    <p class="cmd-value">{"T":10033}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_ODOM</p>
+                                    <p class="cmd-value">{"T":10035}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_STATE</p>
+                                    <p class="cmd-value">{"T":10037,"id":1}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_RETRY</p>
+                                    <p class="cmd-value">{"T":11003,"retry":1}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_TIMEOUT</p>
+                                    <p class="cmd-value">{"T":11004,"floor":2000,"ceil":10000}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_MODEL</p>
+                                    <p class="cmd-value">{"T":11005,"id":3,"type":115}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_ODOM_CFG</p>
+                                    <p class="cmd-value">{"T":11006,"r":0.05,"track":0.3,"left":[1,3],"right":[2,4],"flip":[2,4]}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
+                            <div class="info-box json-cmd-info">
+                                <div>
+                                    <p>CMD_DDSM_FB_MODE</p>
+                                    <p class="cmd-value">{"T":11007,"bin":1}</p>
+                                </div>
+                                <button class="w-btn">INPUT</button>
+                            </div>
                             <div class="info-box json-cmd-info">
                                 <div>
                                     <p>CMD_HEARTBEAT_TIME</p>